@@ -7,27 +7,85 @@ import android.bluetooth.BluetoothDevice
 import android.bluetooth.BluetoothGatt
 import android.bluetooth.BluetoothGattCallback
 import android.bluetooth.BluetoothGattCharacteristic
-import android.bluetooth.BluetoothGattService
 import android.bluetooth.BluetoothManager
 import android.bluetooth.BluetoothProfile
+import android.bluetooth.BluetoothStatusCodes
 import android.content.Context
 import android.content.pm.PackageManager
 import android.os.Build
+import android.os.Handler
+import android.os.Looper
 import androidx.core.content.ContextCompat
 import java.util.UUID
 
+// Keeps one GATT connection to the bridge and feeds queued payloads through it
+// via WriteQueue (one write outstanding, write-without-response, merging). The
+// RX characteristic is looked up once per connection and reused for every
+// write. A payload accepted by sendToPager is either written or its onDropped
+// callback runs on the main thread.
 object BlePagerClient {
-    @Volatile
+    // Matches the firmware's preferred ATT MTU (one 251-byte DLE packet).
+    private const val PREFERRED_MTU = 247
+    private const val DEFAULT_MTU = 23
+    private const val ATT_WRITE_HEADER_BYTES = 3
+    private const val MAX_QUEUED_PAYLOADS = 64
+    private const val MAX_CONNECT_ATTEMPTS = 3
+    private const val MAX_WRITE_ATTEMPTS = 3
+    private const val BUSY_RETRY_MS = 20L
+
+    private val lock = Any()
+    private val mainHandler = Handler(Looper.getMainLooper())
+    private val queue = WriteQueue(MAX_QUEUED_PAYLOADS, MAX_WRITE_ATTEMPTS)
+
+    private var appContext: Context? = null
+    private var target: BluetoothDevice? = null
+    private var serviceUuid: UUID? = null
+    private var rxUuid: UUID? = null
+    private var persistent = true
+
     private var activeGatt: BluetoothGatt? = null
+    private var rxCharacteristic: BluetoothGattCharacteristic? = null
+    private var mtu = DEFAULT_MTU
+    private var connectAttempts = 0
+
+    @SuppressLint("MissingPermission")
+    private val link = GattLink { bytes, noResponse ->
+        val g = activeGatt
+        val characteristic = rxCharacteristic
+        if (g == null || characteristic == null) {
+            return@GattLink WriteStart.FAILED
+        }
+        val writeType = if (noResponse) {
+            BluetoothGattCharacteristic.WRITE_TYPE_NO_RESPONSE
+        } else {
+            BluetoothGattCharacteristic.WRITE_TYPE_DEFAULT
+        }
+        if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.TIRAMISU) {
+            when (g.writeCharacteristic(characteristic, bytes, writeType)) {
+                BluetoothStatusCodes.SUCCESS -> WriteStart.STARTED
+                BluetoothStatusCodes.ERROR_GATT_WRITE_REQUEST_BUSY -> WriteStart.BUSY
+                else -> WriteStart.FAILED
+            }
+        } else {
+            characteristic.writeType = writeType
+            @Suppress("DEPRECATION")
+            characteristic.value = bytes
+            @Suppress("DEPRECATION")
+            if (g.writeCharacteristic(characteristic)) WriteStart.STARTED else WriteStart.FAILED
+        }
+    }
 
-    fun sendToPager(context: Context, payload: String): Boolean {
+    // Returns false when the payload was not queued. Once queued it is either
+    // written or onDropped runs (main thread) because the bridge could not be
+    // reached or kept rejecting the write.
+    fun sendToPager(context: Context, payload: String, onDropped: () -> Unit = {}): Boolean {
         if (!hasBluetoothPermission(context)) {
             return false
         }
 
         val config = BridgePreferences.loadConfig(context)
-        val serviceUuid = runCatching { UUID.fromString(config.serviceUuid) }.getOrNull() ?: return false
-        val rxUuid = runCatching { UUID.fromString(config.rxUuid) }.getOrNull() ?: return false
+        val service = runCatching { UUID.fromString(config.serviceUuid) }.getOrNull() ?: return false
+        val rx = runCatching { UUID.fromString(config.rxUuid) }.getOrNull() ?: return false
 
         val manager = context.getSystemService(Context.BLUETOOTH_SERVICE) as? BluetoothManager ?: return false
         val adapter = manager.adapter ?: return false
@@ -35,8 +93,26 @@ object BlePagerClient {
             return false
         }
 
-        val target = findTarget(adapter, config.deviceAddress, config.deviceName) ?: return false
-        connectAndWrite(context, target, serviceUuid, rxUuid, payload)
+        val device = findTarget(adapter, config.deviceAddress, config.deviceName) ?: return false
+        synchronized(lock) {
+            if (!queue.offer(payload.toByteArray(), onDropped)) {
+                return false
+            }
+            persistent = config.persistentConnection
+
+            val sameLink = activeGatt != null && target?.address == device.address &&
+                serviceUuid == service && rxUuid == rx
+            appContext = context.applicationContext
+            serviceUuid = service
+            rxUuid = rx
+            if (sameLink) {
+                pumpLocked()
+            } else {
+                target = device
+                connectAttempts = 0
+                connectLocked()
+            }
+        }
         return true
     }
 
@@ -51,74 +127,126 @@ object BlePagerClient {
     }
 
     @SuppressLint("MissingPermission")
-    private fun connectAndWrite(
-        context: Context,
-        device: BluetoothDevice,
-        serviceUuid: UUID,
-        rxUuid: UUID,
-        payload: String
-    ) {
+    private fun connectLocked() {
+        val context = appContext ?: return
+        val device = target ?: return
         activeGatt?.close()
+        resetLinkLocked()
+        connectAttempts++
+        activeGatt = device.connectGatt(context, false, gattCallback, BluetoothDevice.TRANSPORT_LE)
+    }
+
+    private fun resetLinkLocked() {
         activeGatt = null
+        rxCharacteristic = null
+        mtu = DEFAULT_MTU
+        queue.onLinkLost()
+    }
 
-        val gatt = device.connectGatt(context, false, object : BluetoothGattCallback() {
-            override fun onConnectionStateChange(g: BluetoothGatt, status: Int, newState: Int) {
-                if (status != BluetoothGatt.GATT_SUCCESS) {
+    private fun reportDropped(dropped: List<() -> Unit>) {
+        dropped.forEach { mainHandler.post(it) }
+    }
+
+    private val gattCallback = object : BluetoothGattCallback() {
+        @SuppressLint("MissingPermission")
+        override fun onConnectionStateChange(g: BluetoothGatt, status: Int, newState: Int) {
+            synchronized(lock) {
+                if (g != activeGatt) {
                     g.close()
-                    if (activeGatt == g) activeGatt = null
                     return
                 }
-                if (newState == BluetoothProfile.STATE_CONNECTED) {
-                    g.discoverServices()
-                } else {
-                    g.close()
-                    if (activeGatt == g) activeGatt = null
+                if (status == BluetoothGatt.GATT_SUCCESS && newState == BluetoothProfile.STATE_CONNECTED) {
+                    if (!g.requestMtu(PREFERRED_MTU)) {
+                        g.discoverServices()
+                    }
+                    return
+                }
+                // A connect that reports an error status is a failed attempt,
+                // not a usable link: close it and go through the retry below.
+                g.close()
+                resetLinkLocked()
+                // Reconnect while there is still work queued; give up after a few
+                // failed attempts and tell the senders their payloads were dropped.
+                if (!queue.isEmpty()) {
+                    if (connectAttempts < MAX_CONNECT_ATTEMPTS) {
+                        connectLocked()
+                    } else {
+                        reportDropped(queue.dropAll())
+                    }
                 }
             }
+        }
 
-            override fun onServicesDiscovered(g: BluetoothGatt, status: Int) {
-                if (status != BluetoothGatt.GATT_SUCCESS) {
-                    g.disconnect()
+        @SuppressLint("MissingPermission")
+        override fun onMtuChanged(g: BluetoothGatt, mtu: Int, status: Int) {
+            synchronized(lock) {
+                if (g != activeGatt) {
                     return
                 }
-                val service: BluetoothGattService = g.getService(serviceUuid) ?: run {
-                    g.disconnect()
+                if (status == BluetoothGatt.GATT_SUCCESS) {
+                    this@BlePagerClient.mtu = mtu
+                }
+                g.discoverServices()
+            }
+        }
+
+        @SuppressLint("MissingPermission")
+        override fun onServicesDiscovered(g: BluetoothGatt, status: Int) {
+            synchronized(lock) {
+                if (g != activeGatt) {
                     return
                 }
-                val characteristic: BluetoothGattCharacteristic = service.getCharacteristic(rxUuid) ?: run {
+                val service = serviceUuid?.let { g.getService(it) }
+                val characteristic = rxUuid?.let { service?.getCharacteristic(it) }
+                if (status != BluetoothGatt.GATT_SUCCESS || characteristic == null) {
                     g.disconnect()
                     return
                 }
+                rxCharacteristic = characteristic
+                connectAttempts = 0
+                pumpLocked()
+            }
+        }
 
-                val bytes = payload.toByteArray()
-                characteristic.value = bytes
-                characteristic.writeType = BluetoothGattCharacteristic.WRITE_TYPE_DEFAULT
-                if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.TIRAMISU) {
-                    val queued = g.writeCharacteristic(
-                        characteristic,
-                        bytes,
-                        BluetoothGattCharacteristic.WRITE_TYPE_DEFAULT
-                    )
-                    if (queued != BluetoothGatt.GATT_SUCCESS) {
-                        g.disconnect()
-                    }
-                } else {
-                    @Suppress("DEPRECATION")
-                    if (!g.writeCharacteristic(characteristic)) {
-                        g.disconnect()
-                    }
+        override fun onCharacteristicWrite(
+            g: BluetoothGatt,
+            characteristic: BluetoothGattCharacteristic,
+            status: Int
+        ) {
+            synchronized(lock) {
+                if (g != activeGatt) {
+                    return
                 }
+                reportDropped(queue.onWriteComplete(status == BluetoothGatt.GATT_SUCCESS))
+                pumpLocked()
             }
+        }
+    }
 
-            override fun onCharacteristicWrite(
-                g: BluetoothGatt,
-                characteristic: BluetoothGattCharacteristic,
-                status: Int
-            ) {
+    @SuppressLint("MissingPermission")
+    private fun pumpLocked() {
+        val g = activeGatt ?: return
+        val characteristic = rxCharacteristic ?: return
+        if (queue.writeInFlight) {
+            return
+        }
+        if (queue.isEmpty()) {
+            if (!persistent) {
                 g.disconnect()
             }
-        })
-        activeGatt = gatt
+            return
+        }
+
+        val noResponse = (characteristic.properties and BluetoothGattCharacteristic.PROPERTY_WRITE_NO_RESPONSE) != 0
+        when (queue.pump(link, mtu - ATT_WRITE_HEADER_BYTES, noResponse)) {
+            WriteStart.BUSY -> mainHandler.postDelayed({ synchronized(lock) { pumpLocked() } }, BUSY_RETRY_MS)
+            // Counts as a failed write; reconnecting resends what is still queued.
+            WriteStart.FAILED -> {
+                reportDropped(queue.onWriteComplete(false))
+                g.disconnect()
+            }
+            WriteStart.STARTED, null -> Unit
+        }
     }
 
     private fun hasBluetoothPermission(context: Context): Boolean {
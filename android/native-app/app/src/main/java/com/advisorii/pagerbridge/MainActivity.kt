@@ -96,6 +96,7 @@ class MainActivity : AppCompatActivity() {
         findViewById<EditText>(R.id.edtServiceUuid).setText(config.serviceUuid)
         findViewById<EditText>(R.id.edtRxUuid).setText(config.rxUuid)
         findViewById<Switch>(R.id.switchOngoingNotification).isChecked = config.ongoingNotification
+        findViewById<Switch>(R.id.switchPersistentConnection).isChecked = config.persistentConnection
         renderState()
     }
 
@@ -105,7 +106,8 @@ class MainActivity : AppCompatActivity() {
             deviceAddress = findViewById<EditText>(R.id.edtDeviceAddress).text.toString(),
             serviceUuid = findViewById<EditText>(R.id.edtServiceUuid).text.toString(),
             rxUuid = findViewById<EditText>(R.id.edtRxUuid).text.toString(),
-            ongoingNotification = findViewById<Switch>(R.id.switchOngoingNotification).isChecked
+            ongoingNotification = findViewById<Switch>(R.id.switchOngoingNotification).isChecked,
+            persistentConnection = findViewById<Switch>(R.id.switchPersistentConnection).isChecked
         )
         BridgePreferences.saveConfig(this, config)
         BridgeForegroundService.sync(this)
@@ -24,15 +24,20 @@ class MessageNotificationListener : NotificationListenerService() {
         val sanitizedBody = body.replace("\n", " ")
         val preview = sanitizedBody.take(80)
         val outbound = "SEND $sender: $sanitizedBody\n"
-        val sent = BlePagerClient.sendToPager(this, outbound)
+        val appContext = applicationContext
+        val sent = BlePagerClient.sendToPager(this, outbound) {
+            BridgePreferences.appendLog(appContext, "[${timestamp()}] dropped | $sender: $preview")
+            BridgeForegroundService.sync(appContext)
+        }
 
-        val ts = SimpleDateFormat("HH:mm:ss", Locale.US).format(Date())
         val result = if (sent) "queued" else "failed"
-        BridgePreferences.appendLog(this, "[$ts] $result | $sender: $preview")
+        BridgePreferences.appendLog(this, "[${timestamp()}] $result | $sender: $preview")
         BridgePreferences.incrementPassCount(this)
         BridgeForegroundService.sync(this)
     }
 
+    private fun timestamp(): String = SimpleDateFormat("HH:mm:ss", Locale.US).format(Date())
+
     companion object {
         private const val GOOGLE_MESSAGES_PACKAGE = "com.google.android.apps.messaging"
     }
@@ -0,0 +1,125 @@
+package com.advisorii.pagerbridge
+
+// Result of asking the link to start one characteristic write.
+enum class WriteStart { STARTED, BUSY, FAILED }
+
+// The part of a GATT connection the write queue drives. BlePagerClient backs it
+// with BluetoothGatt; the JVM tests back it with a fake.
+fun interface GattLink {
+    fun write(bytes: ByteArray, noResponse: Boolean): WriteStart
+}
+
+// Payloads waiting for the bridge, with at most one write outstanding (the
+// stack's write callback is the flow-control signal). Payloads that fit in one
+// ATT packet go out as write-without-response and consecutive newline-terminated
+// ones are merged up to the MTU. A payload only leaves the queue once the write
+// carrying it is confirmed; a write that fails is retried, and after
+// maxWriteAttempts failures its payloads are dropped and their onDropped
+// callbacks returned to the caller. Not thread-safe: BlePagerClient calls it
+// under its lock and runs the returned callbacks after.
+class WriteQueue(
+    private val maxQueued: Int,
+    private val maxWriteAttempts: Int
+) {
+    private class Entry(val bytes: ByteArray, val onDropped: () -> Unit)
+
+    private val pending = ArrayDeque<Entry>()
+    private var inFlight = 0
+    private var failedAttempts = 0
+
+    val size: Int get() = pending.size
+    val writeInFlight: Boolean get() = inFlight > 0
+
+    fun isEmpty(): Boolean = pending.isEmpty()
+
+    // False when the queue is full; the payload was not taken.
+    fun offer(bytes: ByteArray, onDropped: () -> Unit = {}): Boolean {
+        if (pending.size >= maxQueued) {
+            return false
+        }
+        pending.addLast(Entry(bytes, onDropped))
+        return true
+    }
+
+    // Starts the next write unless one is outstanding or nothing is queued
+    // (returns null then). BUSY changes nothing, so the caller just retries.
+    // FAILED leaves the write outstanding: the caller reports it with
+    // onWriteComplete(false) so it counts towards maxWriteAttempts.
+    fun pump(link: GattLink, maxPayload: Int, noResponseSupported: Boolean): WriteStart? {
+        if (inFlight > 0 || pending.isEmpty()) {
+            return null
+        }
+        val (bytes, merged) = nextWrite(maxPayload)
+        val noResponse = noResponseSupported && bytes.size <= maxPayload
+        val result = link.write(bytes, noResponse)
+        if (result != WriteStart.BUSY) {
+            inFlight = merged
+        }
+        return result
+    }
+
+    // Call from the write callback. Returns the callbacks of dropped payloads.
+    fun onWriteComplete(success: Boolean): List<() -> Unit> {
+        if (inFlight == 0) {
+            return emptyList()
+        }
+        val count = inFlight
+        inFlight = 0
+        if (success) {
+            failedAttempts = 0
+            repeat(count) { pending.removeFirst() }
+            return emptyList()
+        }
+        failedAttempts++
+        if (failedAttempts < maxWriteAttempts) {
+            return emptyList()
+        }
+        failedAttempts = 0
+        return List(count) { pending.removeFirst().onDropped }
+    }
+
+    // The link went down with a write unconfirmed: keep its payloads so they
+    // are written again after reconnecting (the bridge may then see a repeat).
+    fun onLinkLost() {
+        inFlight = 0
+    }
+
+    // Empties the queue, e.g. when the bridge cannot be reached; returns the
+    // dropped payloads' callbacks.
+    fun dropAll(): List<() -> Unit> {
+        val dropped = pending.map { it.onDropped }
+        pending.clear()
+        inFlight = 0
+        failedAttempts = 0
+        return dropped
+    }
+
+    // Merges newline-terminated text payloads into one write while they fit in
+    // a single ATT packet; the firmware splits text commands on newlines.
+    private fun nextWrite(maxPayload: Int): Pair<ByteArray, Int> {
+        val first = pending.first().bytes
+        var total = first.size
+        var count = 1
+        while (count < pending.size && pending[count - 1].bytes.lastOrNull() == NEWLINE &&
+            total + pending[count].bytes.size <= maxPayload
+        ) {
+            total += pending[count].bytes.size
+            count++
+        }
+        if (count == 1) {
+            return Pair(first, 1)
+        }
+        val out = ByteArray(total)
+        var offset = 0
+        for (i in 0 until count) {
+            val part = pending[i].bytes
+            System.arraycopy(part, 0, out, offset, part.size)
+            offset += part.size
+        }
+        return Pair(out, count)
+    }
+
+    private companion object {
+        const val NEWLINE = '\n'.code.toByte()
+    }
+}
@@ -0,0 +1,141 @@
+package com.advisorii.pagerbridge
+
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertTrue
+import org.junit.Test
+
+// Runs WriteQueue against a fake GATT connection on a virtual clock and prints
+// per-message latency and messages/minute, next to a model of the old
+// connect-write-disconnect client. Timing follows the firmware: the burst
+// connection profile (30 ms interval at worst) while writes flow, a
+// write-without-response confirmed at the next connection event and a write
+// request one event later. The per-message model charges a fresh connection,
+// MTU exchange and service discovery for every message.
+class LinkLatencyBenchTest {
+    private companion object {
+        const val CONNECTION_INTERVAL_MS = 30L
+        const val ATT_PAYLOAD = 247 - 3
+        const val CONNECT_MS = 600L
+        const val MTU_EXCHANGE_MS = 2 * CONNECTION_INTERVAL_MS
+        const val DISCOVERY_MS = 300L
+    }
+
+    // Write completions land on connection events; failWrites makes the first
+    // n writes complete with an error.
+    private class FakeGatt(private val intervalMs: Long, private var failWrites: Int = 0) : GattLink {
+        var nowMs = 0L
+        var completeAtMs = Long.MAX_VALUE
+            private set
+        private var inFlight: ByteArray? = null
+        private var inFlightOk = true
+
+        override fun write(bytes: ByteArray, noResponse: Boolean): WriteStart {
+            check(inFlight == null) { "second write while one is outstanding" }
+            val nextEvent = (nowMs / intervalMs + 1) * intervalMs
+            completeAtMs = if (noResponse) nextEvent else nextEvent + intervalMs
+            inFlight = bytes
+            inFlightOk = failWrites == 0
+            if (failWrites > 0) failWrites--
+            return WriteStart.STARTED
+        }
+
+        // Returns the completed write and whether it succeeded.
+        fun complete(): Pair<ByteArray, Boolean> {
+            val bytes = checkNotNull(inFlight)
+            inFlight = null
+            completeAtMs = Long.MAX_VALUE
+            return Pair(bytes, inFlightOk)
+        }
+    }
+
+    private class Result(val latenciesMs: List<Long>, val spanMs: Long) {
+        val meanMs get() = latenciesMs.average()
+        val p95Ms get() = latenciesMs.sorted()[(latenciesMs.size * 95 / 100).coerceAtMost(latenciesMs.size - 1)]
+        val maxMs get() = latenciesMs.max()
+        val perMinute get() = latenciesMs.size * 60_000.0 / spanMs
+    }
+
+    private fun payload(index: Int) = "SEND Sender $index: message body of a typical text\n"
+
+    private fun runPersistent(arrivalsMs: List<Long>, failWrites: Int = 0): Result {
+        val queue = WriteQueue(maxQueued = 64, maxWriteAttempts = 3)
+        val gatt = FakeGatt(CONNECTION_INTERVAL_MS, failWrites)
+        val doneMs = LongArray(arrivalsMs.size) { -1 }
+        var next = 0
+        while (next < arrivalsMs.size || !queue.isEmpty()) {
+            val arrival = if (next < arrivalsMs.size) arrivalsMs[next] else Long.MAX_VALUE
+            if (arrival <= gatt.completeAtMs) {
+                gatt.nowMs = arrival
+                assertTrue(queue.offer(payload(next).toByteArray()))
+                next++
+            } else {
+                gatt.nowMs = gatt.completeAtMs
+                val (bytes, ok) = gatt.complete()
+                queue.onWriteComplete(ok)
+                if (ok) {
+                    String(bytes).split('\n').filter { it.isNotEmpty() }.forEach { line ->
+                        val index = line.removePrefix("SEND Sender ").substringBefore(':').toInt()
+                        doneMs[index] = gatt.nowMs
+                    }
+                }
+            }
+            queue.pump(gatt, ATT_PAYLOAD, noResponseSupported = true)
+        }
+        assertTrue("every message delivered", doneMs.all { it >= 0 })
+        val latencies = arrivalsMs.indices.map { doneMs[it] - arrivalsMs[it] }
+        return Result(latencies, doneMs.max() - arrivalsMs.first())
+    }
+
+    private fun runConnectPerMessage(arrivalsMs: List<Long>): Result {
+        val perMessageMs = CONNECT_MS + MTU_EXCHANGE_MS + DISCOVERY_MS + 2 * CONNECTION_INTERVAL_MS
+        var freeAtMs = 0L
+        val doneMs = arrivalsMs.map { arrival ->
+            freeAtMs = maxOf(arrival, freeAtMs) + perMessageMs
+            freeAtMs
+        }
+        return Result(arrivalsMs.indices.map { doneMs[it] - arrivalsMs[it] }, doneMs.last() - arrivalsMs.first())
+    }
+
+    private fun report(name: String, result: Result) {
+        println(
+            "%-28s n=%d latency mean=%.1fms p95=%dms max=%dms throughput=%.0f msgs/min".format(
+                name, result.latenciesMs.size, result.meanMs, result.p95Ms, result.maxMs, result.perMinute
+            )
+        )
+    }
+
+    @Test
+    fun spacedMessagesLatency() {
+        val arrivals = List(60) { it * 2_000L + (it * 37L) % 500 }
+        val persistent = runPersistent(arrivals)
+        val perMessage = runConnectPerMessage(arrivals)
+        report("spaced persistent", persistent)
+        report("spaced connect-per-message", perMessage)
+
+        assertTrue(persistent.maxMs <= 2 * CONNECTION_INTERVAL_MS)
+        assertTrue(persistent.meanMs * 10 < perMessage.meanMs)
+    }
+
+    @Test
+    fun burstThroughput() {
+        val arrivals = List(64) { 0L }
+        val persistent = runPersistent(arrivals)
+        val perMessage = runConnectPerMessage(arrivals)
+        report("burst persistent", persistent)
+        report("burst connect-per-message", perMessage)
+
+        // The first payload goes out alone as soon as it arrives; the other 63
+        // (46-47 bytes each) share 244-byte packets five at a time, one packet
+        // per connection event: 1 + 13 events.
+        assertEquals(14L * CONNECTION_INTERVAL_MS, persistent.maxMs)
+        assertTrue(persistent.perMinute > 20 * perMessage.perMinute)
+    }
+
+    @Test
+    fun failedWritesAreRetriedNotLost() {
+        val arrivals = List(10) { it * 100L }
+        val result = runPersistent(arrivals, failWrites = 2)
+        report("persistent, 2 failed writes", result)
+        assertEquals(10, result.latenciesMs.size)
+    }
+}
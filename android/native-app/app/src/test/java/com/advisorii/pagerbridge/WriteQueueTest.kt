@@ -0,0 +1,138 @@
+package com.advisorii.pagerbridge
+
+import org.junit.Assert.assertArrayEquals
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertFalse
+import org.junit.Assert.assertNull
+import org.junit.Assert.assertTrue
+import org.junit.Test
+
+class WriteQueueTest {
+    private class RecordingLink(var result: WriteStart = WriteStart.STARTED) : GattLink {
+        val writes = mutableListOf<Pair<String, Boolean>>()
+
+        override fun write(bytes: ByteArray, noResponse: Boolean): WriteStart {
+            writes += Pair(String(bytes), noResponse)
+            return result
+        }
+    }
+
+    private val maxPayload = 244
+
+    @Test
+    fun payloadStaysQueuedUntilWriteConfirmed() {
+        val queue = WriteQueue(maxQueued = 8, maxWriteAttempts = 3)
+        val link = RecordingLink()
+        queue.offer("SEND a\n".toByteArray())
+
+        assertEquals(WriteStart.STARTED, queue.pump(link, maxPayload, noResponseSupported = true))
+        assertEquals(1, queue.size)
+        assertTrue(queue.writeInFlight)
+        assertNull(queue.pump(link, maxPayload, noResponseSupported = true))
+
+        assertTrue(queue.onWriteComplete(success = true).isEmpty())
+        assertTrue(queue.isEmpty())
+        assertEquals(listOf(Pair("SEND a\n", true)), link.writes)
+    }
+
+    @Test
+    fun failedWriteIsRetriedThenReportedAsDropped() {
+        val queue = WriteQueue(maxQueued = 8, maxWriteAttempts = 2)
+        val link = RecordingLink()
+        var dropped = 0
+        queue.offer("SEND a\n".toByteArray()) { dropped++ }
+
+        queue.pump(link, maxPayload, noResponseSupported = true)
+        assertTrue(queue.onWriteComplete(success = false).isEmpty())
+        assertEquals(1, queue.size)
+
+        queue.pump(link, maxPayload, noResponseSupported = true)
+        val callbacks = queue.onWriteComplete(success = false)
+        callbacks.forEach { it() }
+        assertEquals(1, dropped)
+        assertTrue(queue.isEmpty())
+        assertEquals(2, link.writes.size)
+    }
+
+    @Test
+    fun writeThatFailsToStartCountsAsAttempt() {
+        val queue = WriteQueue(maxQueued = 8, maxWriteAttempts = 1)
+        val link = RecordingLink(WriteStart.FAILED)
+        var dropped = 0
+        queue.offer("SEND a\n".toByteArray()) { dropped++ }
+
+        assertEquals(WriteStart.FAILED, queue.pump(link, maxPayload, noResponseSupported = true))
+        queue.onWriteComplete(success = false).forEach { it() }
+        assertEquals(1, dropped)
+    }
+
+    @Test
+    fun busyLeavesQueueUntouched() {
+        val queue = WriteQueue(maxQueued = 8, maxWriteAttempts = 3)
+        val link = RecordingLink(WriteStart.BUSY)
+        queue.offer("SEND a\n".toByteArray())
+
+        assertEquals(WriteStart.BUSY, queue.pump(link, maxPayload, noResponseSupported = true))
+        assertFalse(queue.writeInFlight)
+        link.result = WriteStart.STARTED
+        assertEquals(WriteStart.STARTED, queue.pump(link, maxPayload, noResponseSupported = true))
+    }
+
+    @Test
+    fun linkLossResendsUnconfirmedWrite() {
+        val queue = WriteQueue(maxQueued = 8, maxWriteAttempts = 3)
+        val link = RecordingLink()
+        queue.offer("SEND a\n".toByteArray())
+
+        queue.pump(link, maxPayload, noResponseSupported = true)
+        queue.onLinkLost()
+        assertEquals(1, queue.size)
+        queue.pump(link, maxPayload, noResponseSupported = true)
+        assertEquals(listOf("SEND a\n", "SEND a\n"), link.writes.map { it.first })
+    }
+
+    @Test
+    fun dropAllReportsEveryAcceptedPayload() {
+        val queue = WriteQueue(maxQueued = 8, maxWriteAttempts = 3)
+        var dropped = 0
+        repeat(3) { queue.offer("SEND $it\n".toByteArray()) { dropped++ } }
+
+        queue.dropAll().forEach { it() }
+        assertEquals(3, dropped)
+        assertTrue(queue.isEmpty())
+    }
+
+    @Test
+    fun fullQueueRejectsPayload() {
+        val queue = WriteQueue(maxQueued = 2, maxWriteAttempts = 3)
+        assertTrue(queue.offer("a\n".toByteArray()))
+        assertTrue(queue.offer("b\n".toByteArray()))
+        assertFalse(queue.offer("c\n".toByteArray()))
+    }
+
+    @Test
+    fun mergesNewlineTerminatedPayloadsUpToPacketSize() {
+        val queue = WriteQueue(maxQueued = 8, maxWriteAttempts = 3)
+        val link = RecordingLink()
+        queue.offer("SEND one\n".toByteArray())
+        queue.offer("SEND two\n".toByteArray())
+        queue.offer("SEND three\n".toByteArray())
+
+        queue.pump(link, maxPayload = 20, noResponseSupported = true)
+        assertEquals(Pair("SEND one\nSEND two\n", true), link.writes.single())
+        queue.onWriteComplete(success = true)
+        assertEquals(1, queue.size)
+    }
+
+    @Test
+    fun oversizedPayloadUsesWriteWithResponse() {
+        val queue = WriteQueue(maxQueued = 8, maxWriteAttempts = 3)
+        val link = RecordingLink()
+        val long = ByteArray(300) { 'x'.code.toByte() }
+        queue.offer(long)
+
+        queue.pump(link, maxPayload, noResponseSupported = true)
+        assertFalse(link.writes.single().second)
+        assertArrayEquals(long, link.writes.single().first.toByteArray())
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "packed_bits.h"
+#include "wave_symbols.h"
+
+// Stand-in for the RMT TX channel: pulls symbol words from a
+// BitRunSymbolSource the way the streaming encoder does on target (full
+// memory block up front, then one half per ping-pong refill) and rebuilds the
+// bit stream from the symbol durations so the output can be checked.
+class MockRmtSink {
+ public:
+  struct Stats {
+    size_t symbols = 0;
+    size_t refills = 0;
+    uint64_t airtimeUs = 0;
+  };
+
+  explicit MockRmtSink(size_t memBlockSymbols) : memBlockSymbols_(memBlockSymbols) {}
+
+  Stats transmit(const pocsag::WaveStreamInput& input, PackedBits* decoded) {
+    Stats stats;
+    pocsag::BitRunSymbolSource source;
+    source.reset(input);
+    if (decoded != nullptr) {
+      decoded->clear();
+    }
+    runLevel_ = false;
+    runUs_ = 0;
+
+    size_t budget = memBlockSymbols_;
+    uint32_t word = 0;
+    while (source.next(&word)) {
+      if (budget == 0) {
+        stats.refills++;
+        budget = memBlockSymbols_ / 2;
+      }
+      budget--;
+      stats.symbols++;
+      const uint32_t durationUs = pocsag::symbol_duration(word);
+      stats.airtimeUs += durationUs;
+      if (decoded != nullptr) {
+        record(input, ((word >> 15) & 0x1) != 0, durationUs, decoded);
+      }
+    }
+    if (decoded != nullptr) {
+      flush(input, decoded);
+    }
+    return stats;
+  }
+
+ private:
+  void record(const pocsag::WaveStreamInput& input, bool levelHigh, uint32_t durationUs, PackedBits* out) {
+    if (runUs_ != 0 && levelHigh != runLevel_) {
+      flush(input, out);
+    }
+    runLevel_ = levelHigh;
+    runUs_ += durationUs;
+  }
+
+  void flush(const pocsag::WaveStreamInput& input, PackedBits* out) {
+    if (runUs_ == 0 || input.bitPeriodUs == 0) {
+      return;
+    }
+    const bool value = input.driveOneLow ? !runLevel_ : runLevel_;
+    for (uint64_t bits = (runUs_ + input.bitPeriodUs / 2) / input.bitPeriodUs; bits > 0;) {
+      const unsigned chunk = bits > 32 ? 32U : static_cast<unsigned>(bits);
+      out->append(value ? 0xFFFFFFFFu : 0u, chunk);
+      bits -= chunk;
+    }
+    runUs_ = 0;
+  }
+
+  size_t memBlockSymbols_;
+  bool runLevel_ = false;
+  uint64_t runUs_ = 0;
+};
@@ -1,10 +1,16 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cctype>
-#include <cerrno>
+#include <charconv>
+#include <cstddef>
 #include <cstdio>
 #include <cstdint>
 #include <cstring>
 #include <cstdlib>
+#include <new>
 #include <string>
+#include <string_view>
 #include <vector>
 
 extern "C" {
@@ -21,6 +27,7 @@ extern "C" {
 #include "driver/rmt_tx.h"
 #include "driver/usb_serial_jtag.h"
 #include "esp_err.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
 #include "esp_bt.h"
 #include "esp_pm.h"
@@ -28,37 +35,114 @@ extern "C" {
 #include "esp_timer.h"
 #include "esp_system.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
+#include "esp_crc.h"
+#include "nvs.h"
 #include "nvs_flash.h"
 
+#include "packed_bits.h"
+#include "pager_protocol.h"
+#include "pocsag_frame.h"
+#include "seqlock.h"
+#include "wave_symbols.h"
+
+// Build with -DPAGER_COUNT_CXX_ALLOCS=1 (the *_alloccount PlatformIO env) to
+// replace the global operator new/delete with counting wrappers; release
+// builds keep the toolchain's allocator untouched.
+#ifndef PAGER_COUNT_CXX_ALLOCS
+#define PAGER_COUNT_CXX_ALLOCS 0
+#endif
+
+using pocsag::BitRunSymbolSource;
+using pocsag::kBatchBits;
+using pocsag::kMaxBatchesLimit;
+using pocsag::PocsagBatchPacker;
+using pocsag::WaveStreamInput;
+
 namespace {
 constexpr char kTag[] = "pocsag_tx";
 constexpr char kBleDeviceName[] = "PagerBridge";
 constexpr char kServiceUuidStr[] = "1b0ee9b4-e833-5a9e-354c-7e2d486b2b7f";
 constexpr char kRxUuidStr[] = "1b0ee9b4-e833-5a9e-354c-7e2d496b2b7f";
 constexpr char kStatusUuidStr[] = "1b0ee9b4-e833-5a9e-354c-7e2d4a6b2b7f";
+constexpr char kMetricsUuidStr[] = "1b0ee9b4-e833-5a9e-354c-7e2d4b6b2b7f";
 constexpr int kUserLedGpio = 21;            // XIAO ESP32S3 LED_BUILTIN
+// Pins `set gpio` accepts: the XIAO ESP32S3 headers D0, D1, D3-D5 and D8-D10.
+// D2 (GPIO3) is a strapping pin, D6/D7 (GPIO43/44) carry the UART console,
+// and flash/PSRAM (26-37), USB (19/20) and the LED are never broken out as data.
+constexpr int kDataGpioAllowed[] = {1, 2, 4, 5, 6, 7, 8, 9};
 constexpr bool kUserLedActiveHigh = false;  // XIAO user LED is active-low
 constexpr uint32_t kUserLedBootOnMs = 10000;
 constexpr uint32_t kUserLedHeartbeatPeriodMs = 15000;
 constexpr uint32_t kUserLedHeartbeatPulseMs = 150;
 constexpr uint32_t kPmArmDelayMs = 10000;   // stay fully awake for initial debug window
-constexpr int kPmMaxFreqMhz = 80;
+constexpr int kPmMaxFreqMhz = 160;          // only reached while a CPU_FREQ_MAX lock is held
 constexpr int kPmMinFreqMhz = 40;
-constexpr bool kPmLightSleepEnable = false;
+// Light sleep only keeps BLE links when the controller can time connection and
+// advertising events across it: modem sleep on and its low-power clock alive
+// while asleep (an external 32 kHz crystal, or the main XTAL kept powered).
+#if CONFIG_BT_CTRL_MODEM_SLEEP_MODE_1 && \
+    (CONFIG_BT_CTRL_LPCLK_SEL_EXT_32K_XTAL || CONFIG_BT_CTRL_MAIN_XTAL_PU_DURING_LIGHT_SLEEP)
+constexpr bool kPmLightSleepSupported = true;
+#else
+constexpr bool kPmLightSleepSupported = false;
+#endif
+constexpr bool kPmLightSleepDefault = kPmLightSleepSupported;
 constexpr esp_power_level_t kBleTxPowerDefault = ESP_PWR_LVL_N0;  // 0 dBm
 constexpr uint32_t kMetricsLogPeriodMs = 60000;
 constexpr uint32_t kCpuSamplePeriodMs = 1000;
-constexpr uint32_t kSyncWord = 0x7CD215D8;
-constexpr uint32_t kIdleWord = 0x7A89C197;
-constexpr uint32_t kMaxRmtDuration = 32767;
-constexpr size_t kMaxRmtItems = 2000;
+constexpr size_t kMaxTaskStats = 32;            // uxTaskGetSystemState buffer on the metrics task
+constexpr size_t kRmtMemBlockSymbols = 128;
+constexpr size_t kMaxPackedPages = 8;  // pages sharing one preamble
+constexpr uint32_t kTxNotifyJob = 1u << 0;      // producer queued a job
+constexpr uint32_t kTxNotifyDone = 1u << 1;     // RMT finished the frame on air
+constexpr uint32_t kTxNotifyConfig = 1u << 2;   // `set` published a new Config
+constexpr size_t kTxQueueDepthPerPriority = 8;
+constexpr size_t kTxRecentPages = 16;           // history used for duplicate coalescing
+constexpr size_t kTxJobTextMax = 256;           // message chars stored per pooled job
+constexpr uint32_t kMaxPreambleBits = 2048;     // frame buffers are reserved for this much preamble
+constexpr uint32_t kTxBenchDefaultPages = 10000;
+constexpr bool kCountCxxAllocs = PAGER_COUNT_CXX_ALLOCS;
+constexpr uint32_t kBaudMin = 200;
+constexpr uint32_t kBaudMax = 4800;
+constexpr uint32_t kCapcodeMax = 0x1FFFFF;      // 21-bit address
+constexpr size_t kMaxProfiles = 16;             // named recipients (see `profile`)
+constexpr size_t kProfileIdMax = 8;             // chars in a profile id
+constexpr size_t kProfileIndexSlots = 32;       // hash index, power of two and >= 2 * kMaxProfiles
+constexpr size_t kBleIngestSlots = 8;           // GATT writes buffered for the parser task
+constexpr size_t kBleIngestSlotBytes = 512;     // max ATT attribute value length
 constexpr uint16_t kAdvFastIntervalMin = 0x0140;  // 200 ms
 constexpr uint16_t kAdvFastIntervalMax = 0x01E0;  // 300 ms
 constexpr int32_t kAdvFastDurationMs = 15000;
+constexpr uint16_t kAdvMediumIntervalMin = 0x0320;   // 500 ms
+constexpr uint16_t kAdvMediumIntervalMax = 0x04B0;   // 750 ms
+constexpr int32_t kAdvMediumDurationMs = 15000;
+constexpr uint16_t kAdvRelaxedIntervalMin = 0x0640;  // 1.0 s
+constexpr uint16_t kAdvRelaxedIntervalMax = 0x0960;  // 1.5 s
+constexpr int32_t kAdvRelaxedDurationMs = 30000;
 constexpr uint16_t kAdvSlowIntervalMin = 0x0C80;  // 2.0 s
 constexpr uint16_t kAdvSlowIntervalMax = 0x12C0;  // 3.0 s
+constexpr uint32_t kAdvLearnMinSamples = 4;        // reconnects needed before the schedule adapts
+constexpr uint32_t kAdvMinTierMs = 5000;
+constexpr uint32_t kAdvScheduleMaxMs = 600000;     // slow advertising starts no later than 10 min
+// Upper edges of the time-to-reconnect histogram buckets; the last bucket is open.
+constexpr uint32_t kReconnectBucketEdgesMs[] = {1000, 2000, 5000, 10000, 20000, 30000, 60000, 120000, 300000};
+constexpr size_t kReconnectBuckets = sizeof(kReconnectBucketEdgesMs) / sizeof(kReconnectBucketEdgesMs[0]) + 1;
+constexpr uint16_t kBlePreferredMtu = 247;       // fills one 251-byte DLE PDU (4-byte L2CAP header)
+constexpr uint16_t kBleDefaultMtu = 23;
+constexpr uint16_t kBleDleTxOctets = 251;
+constexpr uint16_t kBleDleTxTimeUs = 2120;       // 251 octets on LE 1M
+constexpr uint16_t kBleDefaultDleOctets = 27;
+constexpr uint16_t kConnBurstIntervalMin = 12;      // 15 ms (1.25 ms units)
+constexpr uint16_t kConnBurstIntervalMax = 24;      // 30 ms
+constexpr uint16_t kConnBurstLatency = 0;
+constexpr uint16_t kConnBurstTimeout = 400;         // 4 s (10 ms units)
+constexpr uint16_t kConnIdleIntervalMin = 192;      // 240 ms
+constexpr uint16_t kConnIdleIntervalMax = 240;      // 300 ms
+constexpr uint16_t kConnIdleLatency = 3;            // peripheral may skip 3 events when quiet
+constexpr uint16_t kConnIdleTimeout = 500;          // 5 s, > 2 * (1 + latency) * interval
+constexpr uint32_t kConnIdleAfterMs = 5000;         // quiet time before dropping to the idle profile
 
 const ble_uuid128_t kServiceUuid = BLE_UUID128_INIT(
     0x7f, 0x2b, 0x6b, 0x48, 0x2d, 0x7e, 0x4c, 0x35, 0x9e, 0x5a, 0x33, 0xe8, 0xb4, 0xe9, 0x0e, 0x1b);
@@ -66,9 +150,37 @@ const ble_uuid128_t kRxUuid = BLE_UUID128_INIT(
     0x7f, 0x2b, 0x6b, 0x49, 0x2d, 0x7e, 0x4c, 0x35, 0x9e, 0x5a, 0x33, 0xe8, 0xb4, 0xe9, 0x0e, 0x1b);
 const ble_uuid128_t kStatusUuid = BLE_UUID128_INIT(
     0x7f, 0x2b, 0x6b, 0x4a, 0x2d, 0x7e, 0x4c, 0x35, 0x9e, 0x5a, 0x33, 0xe8, 0xb4, 0xe9, 0x0e, 0x1b);
+const ble_uuid128_t kMetricsUuid = BLE_UUID128_INIT(
+    0x7f, 0x2b, 0x6b, 0x4b, 0x2d, 0x7e, 0x4c, 0x35, 0x9e, 0x5a, 0x33, 0xe8, 0xb4, 0xe9, 0x0e, 0x1b);
 
 enum class InputSource : uint8_t { kSerial = 0, kBle = 1 };
-enum class AdvProfile : uint8_t { kFastReconnect = 0, kSlowIdle = 1 };
+// Advertising tiers, stepped through in order after a disconnect until a
+// central reconnects; kSlowIdle runs until then.
+enum class AdvProfile : uint8_t { kFastReconnect = 0, kMedium = 1, kRelaxed = 2, kSlowIdle = 3 };
+constexpr size_t kAdvProfileCount = 4;
+// kCentral: whatever the central chose, before or outside our own requests.
+enum class ConnProfile : uint8_t { kCentral = 0, kBurst = 1, kIdle = 2 };
+constexpr size_t kConnProfileCount = 3;
+
+struct ConnProfileConfig {
+  uint16_t intervalMin;
+  uint16_t intervalMax;
+  uint16_t latency;
+  uint16_t supervisionTimeout;
+  const char* label;
+};
+
+struct ConnProfileMetrics {
+  ConnProfile applied = ConnProfile::kCentral;
+  ConnProfile requested = ConnProfile::kCentral;
+  uint64_t sinceUs = 0;
+  uint64_t timeUs[kConnProfileCount] = {};
+  uint32_t switches = 0;
+  uint32_t failures = 0;
+  uint16_t interval = 0;
+  uint16_t latency = 0;
+  uint16_t timeout = 0;
+};
 
 struct AdvProfileConfig {
   uint16_t intervalMin;
@@ -77,6 +189,17 @@ struct AdvProfileConfig {
   const char* label;
 };
 
+struct AdvSchedulerMetrics {
+  uint32_t reconnectHist[kReconnectBuckets] = {};
+  uint32_t reconnects = 0;
+  uint64_t reconnectTotalMs = 0;
+  uint32_t lastReconnectMs = 0;
+  uint32_t connectsByTier[kAdvProfileCount] = {};
+  int32_t windowMs[kAdvProfileCount] = {};
+  bool learned = false;
+};
+
+// Written under gLinkMetricsLock, read through the seqlock.
 struct RuntimeMetrics {
   uint64_t bootUs = 0;
   uint64_t connStateSinceUs = 0;
@@ -84,6 +207,7 @@ struct RuntimeMetrics {
   uint64_t connectedUs = 0;
   uint64_t disconnectedUs = 0;
   uint64_t advertisingUs = 0;
+  uint64_t advTierUs[kAdvProfileCount] = {};
   bool connected = false;
   bool advertising = false;
 };
@@ -97,57 +221,738 @@ struct CpuMetrics {
   uint64_t mhzOther = 0;
 };
 
+// Per-task share of run time since boot, heaviest tasks first; refreshed by
+// the metrics task.
+struct TaskCpuSnapshot {
+  bool valid = false;
+  uint16_t busyPermille = 0;
+  uint8_t count = 0;
+  pager_proto::MetricsTask tasks[pager_proto::kMetricsMaxTasks] = {};
+};
+
+// Event counters bumped from several tasks. 32-bit relaxed atomics are
+// lock-free on the ESP32 cores, so counting never masks interrupts.
+struct TxPipelineCounters {
+  std::atomic<uint32_t> queued{0};
+  std::atomic<uint32_t> sent{0};
+  std::atomic<uint32_t> failed{0};
+  std::atomic<uint32_t> dropped{0};
+  std::atomic<uint32_t> coalesced{0};
+  std::atomic<uint32_t> airtimeMs{0};
+  std::atomic<uint32_t> encodeUsLast{0};
+  std::atomic<uint32_t> encodeUsMax{0};
+  std::atomic<uint32_t> connects{0};
+  std::atomic<uint32_t> disconnects{0};
+};
+
+// Dequeue-to-first-bit latency, split by whether the RMT channel had to be created.
+struct TxLeadMetrics {
+  uint64_t coldStarts = 0;
+  uint64_t coldLeadUs = 0;
+  uint64_t warmStarts = 0;
+  uint64_t warmLeadUs = 0;
+  uint32_t lastLeadUs = 0;
+  uint32_t maxLeadUs = 0;
+};
+
+// Preamble length chosen per started transmission (see Config::shortPreambleWindowMs).
+struct PreambleMetrics {
+  uint32_t fullFrames = 0;
+  uint32_t shortFrames = 0;
+  uint64_t savedBits = 0;
+  uint64_t savedUs = 0;   // airtime the short preambles saved at their baud
+  uint32_t lastGapMs = 0; // time since the previous transmission for the last short frame
+};
+
+static ConnProfileConfig get_conn_profile_config(ConnProfile profile) {
+  if (profile == ConnProfile::kIdle) {
+    return {kConnIdleIntervalMin, kConnIdleIntervalMax, kConnIdleLatency, kConnIdleTimeout, "idle"};
+  }
+  if (profile == ConnProfile::kBurst) {
+    return {kConnBurstIntervalMin, kConnBurstIntervalMax, kConnBurstLatency, kConnBurstTimeout, "burst"};
+  }
+  return {0, 0, 0, 0, "central"};
+}
+
+// durationMs is the default window, used until enough reconnects have been seen.
 static AdvProfileConfig get_adv_profile_config(AdvProfile profile) {
   if (profile == AdvProfile::kSlowIdle) {
     return {kAdvSlowIntervalMin, kAdvSlowIntervalMax, BLE_HS_FOREVER, "slow-idle"};
   }
+  if (profile == AdvProfile::kRelaxed) {
+    return {kAdvRelaxedIntervalMin, kAdvRelaxedIntervalMax, kAdvRelaxedDurationMs, "relaxed"};
+  }
+  if (profile == AdvProfile::kMedium) {
+    return {kAdvMediumIntervalMin, kAdvMediumIntervalMax, kAdvMediumDurationMs, "medium"};
+  }
   return {kAdvFastIntervalMin, kAdvFastIntervalMax, kAdvFastDurationMs, "fast-reconnect"};
 }
 }
 
 enum class OutputMode : uint8_t { kOpenDrain = 0, kPushPull = 1 };
+enum class TxPriority : uint8_t { kUrgent = 0, kNormal = 1, kLow = 2 };
+enum class TxDropPolicy : uint8_t { kDropOldest = 0, kReject = 1 };
+constexpr size_t kTxPriorityCount = 3;
 
 struct Config {
   uint32_t baud = 512;
   uint32_t preambleBits = 576;
   uint32_t capInd = 1422890;
   uint8_t functionBits = 2;
+  uint8_t maxBatches = 8;  // upper bound per page; longer messages are truncated
   int dataGpio = 4;
   OutputMode output = OutputMode::kPushPull;
   bool invertWords = false;
   bool driveOneLow = true;
   bool idleHigh = true;
+  bool keepRmtChannel = true;        // reuse the RMT channel/encoder across jobs
+  uint32_t rmtReleaseIdleMs = 30000; // release a kept channel after this much idle (0 = never)
+  TxDropPolicy dropPolicy = TxDropPolicy::kDropOldest;  // when a priority level is full
+  uint32_t coalesceWindowMs = 10000; // identical text to the same capcode within this window is merged (0 = off)
+  uint32_t shortPreambleBits = 128;  // preamble for a page that follows a transmission within the window below
+  uint32_t shortPreambleWindowMs = 0;  // how soon after the previous transmission that applies (0 = off)
 };
 
-static Config gConfig;
+// The live Config is published as a whole: `set` copies the current one,
+// changes a field, validates and stores the result in a single seqlock write,
+// then bumps gConfigVersion. Readers take a copy with config_snapshot(); the TX
+// worker holds its own copy and only re-reads it between jobs, when the version
+// changed.
+static Seqlock<Config> gConfigStore;
+static std::atomic<uint32_t> gConfigVersion{0};
+static SemaphoreHandle_t gConfigWriteLock = nullptr;  // serialises `set` from the serial and BLE tasks
+
+static Config config_snapshot() { return gConfigStore.read(); }
+
+struct PocsagFrame {
+  PackedBits bits;
+  uint32_t baud = 0;  // every page in one transmission shares the bit rate
+  uint32_t preambleBits = 0;
+  size_t batches = 0;
+  bool truncated = false;
+};
 
 struct TxJob {
-  std::vector<uint8_t> bits;
+  uint32_t capcode = 0;
+  uint8_t functionBits = 0;
+  uint32_t baud = 0;  // from the recipient profile, 0 = Config::baud
+  TxPriority priority = TxPriority::kNormal;
+  uint16_t msgId = 0;  // sender-assigned id from the binary protocol, 0 for text commands
+  uint32_t messageHash = 0;
+  uint16_t length = 0;
+  int64_t queuedUs = 0;
+  char text[kTxJobTextMax + 1] = {};
+};
+
+enum class TxEnqueueResult : uint8_t { kQueued = 0, kQueuedDroppedOldest = 1, kCoalesced = 2, kRejected = 3 };
+
+struct TxQueueStats {
+  uint32_t depth = 0;
+  uint32_t highWater = 0;
+  uint32_t enqueued = 0;
+  uint32_t dropped = 0;
+  uint32_t coalesced = 0;
+  uint32_t rejected = 0;
+};
+
+static uint32_t fnv1a32(const char* text, size_t length) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < length; ++i) {
+    hash ^= static_cast<uint8_t>(text[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// Fixed-capacity transmit scheduler: one ring per priority, popped urgent first.
+// Pages repeating a recent (capcode, text) pair inside the coalescing window are
+// merged into the earlier one. Safe to call from any task; the critical
+// sections only move pointers, so evicted jobs are handed back for deletion.
+// Depth and counters are mirrored in atomics so depth() and stats() never
+// take the spinlock.
+class TxScheduler {
+ public:
+  TxEnqueueResult push(TxJob* job, TxDropPolicy policy, uint32_t coalesceWindowMs, int64_t nowUs,
+                       TxJob** evicted) {
+    *evicted = nullptr;
+    const size_t level = static_cast<size_t>(job->priority);
+    TxEnqueueResult result = TxEnqueueResult::kQueued;
+    portENTER_CRITICAL(&mux_);
+    Ring& ring = rings_[level];
+    LevelCounters& stats = stats_[level];
+    if (is_recent_duplicate(*job, coalesceWindowMs, nowUs)) {
+      stats.coalesced.fetch_add(1, std::memory_order_relaxed);
+      result = TxEnqueueResult::kCoalesced;
+    } else if (ring.count == ring.jobs.size() && policy == TxDropPolicy::kReject) {
+      stats.rejected.fetch_add(1, std::memory_order_relaxed);
+      result = TxEnqueueResult::kRejected;
+    } else {
+      if (ring.count == ring.jobs.size()) {
+        *evicted = ring.jobs[ring.head];
+        ring.head = (ring.head + 1) % ring.jobs.size();
+        ring.count--;
+        stats.dropped.fetch_add(1, std::memory_order_relaxed);
+        result = TxEnqueueResult::kQueuedDroppedOldest;
+      }
+      ring.jobs[(ring.head + ring.count) % ring.jobs.size()] = job;
+      ring.count++;
+      stats.enqueued.fetch_add(1, std::memory_order_relaxed);
+      stats.depth.store(static_cast<uint32_t>(ring.count), std::memory_order_relaxed);
+      if (ring.count > stats.highWater.load(std::memory_order_relaxed)) {
+        stats.highWater.store(static_cast<uint32_t>(ring.count), std::memory_order_relaxed);
+      }
+      const uint32_t total = static_cast<uint32_t>(depth());
+      if (total > depthHighWater_.load(std::memory_order_relaxed)) {
+        depthHighWater_.store(total, std::memory_order_relaxed);
+      }
+      recent_[recentNext_] = {job->capcode, job->messageHash, job->baud, job->functionBits, nowUs};
+      recentNext_ = (recentNext_ + 1) % recent_.size();
+    }
+    portEXIT_CRITICAL(&mux_);
+    return result;
+  }
+
+  TxJob* pop() {
+    TxJob* job = nullptr;
+    portENTER_CRITICAL(&mux_);
+    for (size_t level = 0; level < rings_.size(); ++level) {
+      Ring& ring = rings_[level];
+      if (ring.count > 0) {
+        job = ring.jobs[ring.head];
+        ring.head = (ring.head + 1) % ring.jobs.size();
+        ring.count--;
+        stats_[level].depth.store(static_cast<uint32_t>(ring.count), std::memory_order_relaxed);
+        break;
+      }
+    }
+    portEXIT_CRITICAL(&mux_);
+    return job;
+  }
+
+  // Puts a job popped earlier back at the head of its level, ahead of anything
+  // queued since; false if that level has filled up in the meantime.
+  bool unpop(TxJob* job) {
+    const size_t level = static_cast<size_t>(job->priority);
+    bool restored = false;
+    portENTER_CRITICAL(&mux_);
+    Ring& ring = rings_[level];
+    if (ring.count < ring.jobs.size()) {
+      ring.head = (ring.head + ring.jobs.size() - 1) % ring.jobs.size();
+      ring.jobs[ring.head] = job;
+      ring.count++;
+      stats_[level].depth.store(static_cast<uint32_t>(ring.count), std::memory_order_relaxed);
+      restored = true;
+    }
+    portEXIT_CRITICAL(&mux_);
+    return restored;
+  }
+
+  // Most urgent level with a page waiting; kTxPriorityCount when empty.
+  size_t top_level() const {
+    for (size_t level = 0; level < stats_.size(); ++level) {
+      if (stats_[level].depth.load(std::memory_order_relaxed) > 0) {
+        return level;
+      }
+    }
+    return kTxPriorityCount;
+  }
+
+  size_t depth() const {
+    size_t total = 0;
+    for (const LevelCounters& stats : stats_) {
+      total += stats.depth.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+
+  // Most pages waiting across all levels at once.
+  uint32_t depth_high_water() const { return depthHighWater_.load(std::memory_order_relaxed); }
+
+  TxQueueStats stats(TxPriority priority) const {
+    const LevelCounters& level = stats_[static_cast<size_t>(priority)];
+    TxQueueStats stats;
+    stats.depth = level.depth.load(std::memory_order_relaxed);
+    stats.highWater = level.highWater.load(std::memory_order_relaxed);
+    stats.enqueued = level.enqueued.load(std::memory_order_relaxed);
+    stats.dropped = level.dropped.load(std::memory_order_relaxed);
+    stats.coalesced = level.coalesced.load(std::memory_order_relaxed);
+    stats.rejected = level.rejected.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+ private:
+  // Written inside the critical section, read without it.
+  struct LevelCounters {
+    std::atomic<uint32_t> depth{0};
+    std::atomic<uint32_t> highWater{0};
+    std::atomic<uint32_t> enqueued{0};
+    std::atomic<uint32_t> dropped{0};
+    std::atomic<uint32_t> coalesced{0};
+    std::atomic<uint32_t> rejected{0};
+  };
+
+  struct Ring {
+    std::array<TxJob*, kTxQueueDepthPerPriority> jobs = {};
+    size_t head = 0;
+    size_t count = 0;
+  };
+
+  // A page only counts as a repeat when it would go out identically: same
+  // address, text, function bits and baud.
+  struct RecentPage {
+    uint32_t capcode;
+    uint32_t messageHash;
+    uint32_t baud;
+    uint8_t functionBits;
+    int64_t atUs;
+  };
+
+  bool is_recent_duplicate(const TxJob& job, uint32_t windowMs, int64_t nowUs) const {
+    if (windowMs == 0) {
+      return false;
+    }
+    const int64_t windowUs = static_cast<int64_t>(windowMs) * 1000;
+    for (const RecentPage& page : recent_) {
+      if (page.atUs != 0 && page.capcode == job.capcode && page.messageHash == job.messageHash &&
+          page.functionBits == job.functionBits && page.baud == job.baud && nowUs - page.atUs < windowUs) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::array<Ring, kTxPriorityCount> rings_ = {};
+  std::array<LevelCounters, kTxPriorityCount> stats_;
+  std::atomic<uint32_t> depthHighWater_{0};
+  std::array<RecentPage, kTxRecentPages> recent_ = {};
+  size_t recentNext_ = 0;
+  portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+};
+
+// Every job that can be alive at once: full scheduler rings, the worker's
+// pending list and the two transmission slots.
+constexpr size_t kTxJobPoolSize = kTxPriorityCount * kTxQueueDepthPerPriority + 3 * kMaxPackedPages;
+
+struct TxJobPoolStats {
+  uint32_t capacity = 0;
+  uint32_t inUse = 0;
+  uint32_t highWater = 0;
+  uint32_t exhausted = 0;
+};
+
+// Fixed pool of TxJob slots so the send path never touches the heap. Jobs are
+// filled in place after acquire() and handed back with release(). stats()
+// reads atomics and never takes the spinlock.
+template <size_t Capacity>
+class BasicTxJobPool {
+ public:
+  BasicTxJobPool() {
+    for (size_t i = 0; i < jobs_.size(); ++i) {
+      free_[i] = &jobs_[i];
+    }
+    freeCount_ = jobs_.size();
+  }
+
+  TxJob* acquire() {
+    TxJob* job = nullptr;
+    portENTER_CRITICAL(&mux_);
+    if (freeCount_ > 0) {
+      job = free_[--freeCount_];
+      const uint32_t inUse = static_cast<uint32_t>(jobs_.size() - freeCount_);
+      inUse_.store(inUse, std::memory_order_relaxed);
+      if (inUse > highWater_.load(std::memory_order_relaxed)) {
+        highWater_.store(inUse, std::memory_order_relaxed);
+      }
+    } else {
+      exhausted_.fetch_add(1, std::memory_order_relaxed);
+    }
+    portEXIT_CRITICAL(&mux_);
+    return job;
+  }
+
+  void release(TxJob* job) {
+    if (job == nullptr) {
+      return;
+    }
+    portENTER_CRITICAL(&mux_);
+    if (freeCount_ < free_.size()) {
+      free_[freeCount_++] = job;
+      inUse_.store(static_cast<uint32_t>(jobs_.size() - freeCount_), std::memory_order_relaxed);
+    }
+    portEXIT_CRITICAL(&mux_);
+  }
+
+  TxJobPoolStats stats() const {
+    TxJobPoolStats stats;
+    stats.capacity = static_cast<uint32_t>(jobs_.size());
+    stats.inUse = inUse_.load(std::memory_order_relaxed);
+    stats.highWater = highWater_.load(std::memory_order_relaxed);
+    stats.exhausted = exhausted_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
+ private:
+  std::array<TxJob, Capacity> jobs_;
+  std::array<TxJob*, Capacity> free_ = {};
+  size_t freeCount_ = 0;
+  std::atomic<uint32_t> inUse_{0};
+  std::atomic<uint32_t> highWater_{0};
+  std::atomic<uint32_t> exhausted_{0};
+  portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+};
+
+using TxJobPool = BasicTxJobPool<kTxJobPoolSize>;
+
+// Fills a pooled job in place; text beyond kTxJobTextMax is cut.
+static void fill_tx_job(TxJob* job, uint32_t capcode, uint8_t functionBits, uint32_t baud, TxPriority priority,
+                        uint16_t msgId, const char* text, size_t length) {
+  if (length > kTxJobTextMax) {
+    length = kTxJobTextMax;
+  }
+  job->capcode = capcode;
+  job->functionBits = functionBits;
+  job->baud = baud;
+  job->priority = priority;
+  job->msgId = msgId;
+  job->length = static_cast<uint16_t>(length);
+  std::memcpy(job->text, text, length);
+  job->text[length] = '\0';
+  job->messageHash = fnv1a32(job->text, length);
+  job->queuedUs = esp_timer_get_time();
+}
+
+// 1..kProfileIdMax chars of [a-z0-9_-].
+static bool valid_profile_id(std::string_view id) {
+  if (id.empty() || id.size() > kProfileIdMax) {
+    return false;
+  }
+  for (const char c : id) {
+    if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_' || c == '-')) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Lowercased copy of `text` into `out` if it is a valid id.
+static bool parse_profile_id(std::string_view text, char (&out)[kProfileIdMax + 1]) {
+  if (text.size() > kProfileIdMax) {
+    return false;
+  }
+  std::memset(out, 0, sizeof(out));
+  for (size_t i = 0; i < text.size(); ++i) {
+    out[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(text[i])));
+  }
+  return valid_profile_id(out);
+}
+
+// Plain struct so the whole table can be stored in NVS as-is.
+struct RecipientProfile {
+  char id[kProfileIdMax + 1];
+  uint32_t capcode;
+  uint8_t functionBits;
+  uint32_t baud;  // 0 = Config::baud
+};
+
+// Named recipients: `send @<id> <message>` pages the profile's capcode with
+// its function bits and baud. Ids are looked up through a small open-addressed
+// hash index (at most half full), so routing a page costs one hash and
+// usually one compare however many profiles exist; the index is rebuilt after
+// any change. Not locked: callers hold gProfileLock.
+class ProfileTable {
+ public:
+  size_t size() const { return count_; }
+  const RecipientProfile& at(size_t i) const { return profiles_[i]; }
+
+  const RecipientProfile* find(std::string_view id) const {
+    const size_t i = index_of(id);
+    return i == count_ ? nullptr : &profiles_[i];
+  }
+
+  // Adds or replaces by id; false when the table is full.
+  bool put(const RecipientProfile& profile) {
+    const size_t i = index_of(profile.id);
+    if (i != count_) {
+      profiles_[i] = profile;
+      return true;
+    }
+    if (count_ == kMaxProfiles) {
+      return false;
+    }
+    profiles_[count_++] = profile;
+    rebuild_index();
+    return true;
+  }
+
+  bool remove(std::string_view id) {
+    const size_t i = index_of(id);
+    if (i == count_) {
+      return false;
+    }
+    profiles_[i] = profiles_[count_ - 1];
+    profiles_[--count_] = {};
+    rebuild_index();
+    return true;
+  }
+
+  // Takes `profiles` as loaded from NVS; false if the count is out of range.
+  bool assign(const RecipientProfile* profiles, size_t count) {
+    if (count > kMaxProfiles) {
+      return false;
+    }
+    profiles_ = {};
+    std::copy(profiles, profiles + count, profiles_.begin());
+    count_ = count;
+    rebuild_index();
+    return true;
+  }
+
+ private:
+  static size_t index_slot(std::string_view id) {
+    return fnv1a32(id.data(), id.size()) & (kProfileIndexSlots - 1);
+  }
+
+  // Position of `id` in profiles_, or count_ when absent.
+  size_t index_of(std::string_view id) const {
+    for (size_t slot = index_slot(id);; slot = (slot + 1) & (kProfileIndexSlots - 1)) {
+      const uint8_t entry = index_[slot];
+      if (entry == 0) {
+        return count_;
+      }
+      if (id == profiles_[entry - 1].id) {
+        return entry - 1;
+      }
+    }
+  }
+
+  void rebuild_index() {
+    index_ = {};
+    for (size_t i = 0; i < count_; ++i) {
+      size_t slot = index_slot(profiles_[i].id);
+      while (index_[slot] != 0) {
+        slot = (slot + 1) & (kProfileIndexSlots - 1);
+      }
+      index_[slot] = static_cast<uint8_t>(i + 1);
+    }
+  }
+
+  std::array<RecipientProfile, kMaxProfiles> profiles_ = {};
+  size_t count_ = 0;
+  std::array<uint8_t, kProfileIndexSlots> index_ = {};  // profile index + 1, 0 = empty
+};
+
+static ProfileTable gProfiles;
+static SemaphoreHandle_t gProfileLock = nullptr;  // commands on the serial and BLE tasks share the table
+
+// Copies the profile out so the caller does not hold the lock.
+static bool find_profile(std::string_view id, RecipientProfile* out) {
+  xSemaphoreTake(gProfileLock, portMAX_DELAY);
+  const RecipientProfile* profile = gProfiles.find(id);
+  if (profile != nullptr) {
+    *out = *profile;
+  }
+  xSemaphoreGive(gProfileLock);
+  return profile != nullptr;
+}
+
+struct BleIngestStats {
+  uint32_t depth = 0;
+  uint32_t highWater = 0;
+  uint32_t pushed = 0;
+  uint32_t dropped = 0;
+  uint32_t oversize = 0;
+};
+
+// Single-producer/single-consumer ring of fixed slots between the GATT access
+// callback (NimBLE host task) and the parser task. push() only copies the
+// write into the tail slot and bumps counters; the consumer processes the head
+// slot in place and then pop()s it.
+class BleIngestRing {
+ public:
+  struct Slot {
+    uint16_t length;
+    char data[kBleIngestSlotBytes];
+  };
+
+  bool push(const os_mbuf* om) {
+    const int length = OS_MBUF_PKTLEN(om);
+    if (length <= 0) {
+      return true;
+    }
+    portENTER_CRITICAL(&mux_);
+    if (static_cast<size_t>(length) > kBleIngestSlotBytes) {
+      oversize_++;
+      portEXIT_CRITICAL(&mux_);
+      return false;
+    }
+    if (count_ == slots_.size()) {
+      dropped_++;
+      portEXIT_CRITICAL(&mux_);
+      return false;
+    }
+    Slot& slot = slots_[tail_];
+    portEXIT_CRITICAL(&mux_);
+
+    // Only the producer touches the tail slot until it is committed below.
+    if (os_mbuf_copydata(om, 0, length, slot.data) != 0) {
+      return false;
+    }
+    slot.length = static_cast<uint16_t>(length);
+
+    portENTER_CRITICAL(&mux_);
+    tail_ = (tail_ + 1) % slots_.size();
+    count_++;
+    pushed_++;
+    if (count_ > highWater_) {
+      highWater_ = static_cast<uint32_t>(count_);
+    }
+    portEXIT_CRITICAL(&mux_);
+    return true;
+  }
+
+  const Slot* peek() {
+    const Slot* slot = nullptr;
+    portENTER_CRITICAL(&mux_);
+    if (count_ > 0) {
+      slot = &slots_[head_];
+    }
+    portEXIT_CRITICAL(&mux_);
+    return slot;
+  }
+
+  void pop() {
+    portENTER_CRITICAL(&mux_);
+    if (count_ > 0) {
+      head_ = (head_ + 1) % slots_.size();
+      count_--;
+    }
+    portEXIT_CRITICAL(&mux_);
+  }
+
+  BleIngestStats stats() {
+    BleIngestStats stats;
+    portENTER_CRITICAL(&mux_);
+    stats.depth = static_cast<uint32_t>(count_);
+    stats.highWater = highWater_;
+    stats.pushed = pushed_;
+    stats.dropped = dropped_;
+    stats.oversize = oversize_;
+    portEXIT_CRITICAL(&mux_);
+    return stats;
+  }
+
+ private:
+  std::array<Slot, kBleIngestSlots> slots_ = {};
+  size_t head_ = 0;
+  size_t tail_ = 0;
+  size_t count_ = 0;
+  uint32_t highWater_ = 0;
+  uint32_t pushed_ = 0;
+  uint32_t dropped_ = 0;
+  uint32_t oversize_ = 0;
+  portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+};
+
+static const char* tx_priority_label(TxPriority priority) {
+  switch (priority) {
+    case TxPriority::kUrgent: return "urgent";
+    case TxPriority::kNormal: return "normal";
+    case TxPriority::kLow: return "low";
+    default: return "?";
+  }
+}
+
+static TxScheduler gTxScheduler;
+static TxJobPool gTxJobPool;
+static std::atomic<uint32_t> gCxxHeapAllocs{0};    // only counted when kCountCxxAllocs
+static std::atomic<uint32_t> gBleIngestAllocs{0};  // operator new calls made on the ble_ingest task
+static TaskHandle_t gTxWorkerTask = nullptr;
+static BleIngestRing gBleIngest;
+static TaskHandle_t gBleIngestTask = nullptr;
+
+// Heap allocations attributed to individual BLE writes (receive to enqueue).
+struct BleRxAllocMetrics {
+  uint32_t writes = 0;
+  uint32_t allocs = 0;
+  uint32_t lastWriteAllocs = 0;
+  uint32_t maxWriteAllocs = 0;
+};
+static Seqlock<BleRxAllocMetrics> gBleRxAllocMetrics;  // written by the ble_ingest task only
+
+struct BleBinaryMetrics {
+  uint32_t frames = 0;
+  uint32_t pages = 0;
+  uint32_t badFrames = 0;
+  uint32_t badRecords = 0;
+};
+static Seqlock<BleBinaryMetrics> gBleBinaryMetrics;  // written by the ble_ingest task only
+
+// Negotiated link parameters and RX write statistics for the current connection.
+struct BleLinkMetrics {
+  int64_t connectUs = 0;
+  uint16_t mtu = kBleDefaultMtu;
+  int64_t mtuUs = 0;
+  uint16_t dleTxOctets = kBleDefaultDleOctets;
+  uint16_t dleTxTimeUs = 0;
+  uint16_t dleRxOctets = kBleDefaultDleOctets;
+  uint16_t dleRxTimeUs = 0;
+  int64_t dleUs = 0;
+  uint32_t rxWrites = 0;
+  uint32_t rxBytes = 0;
+  uint32_t maxWriteBytes = 0;
+  uint32_t longWrites = 0;  // writes larger than MTU-3, i.e. sent via prepare/execute
+  int64_t firstWriteUs = 0;
+  int64_t lastWriteUs = 0;
 };
+static Seqlock<BleLinkMetrics> gBleLink;  // written by the NimBLE host task only
+static uint16_t gBleStatusValHandle = 0;
+static std::atomic<bool> gBleStatusSubscribed{false};  // written by the NimBLE host task
 
-static QueueHandle_t gTxQueue = nullptr;
+// Status notifications go out from whichever task publishes the TX event.
+struct BleAckCounters {
+  std::atomic<uint32_t> notifies{0};
+  std::atomic<uint32_t> entries{0};
+  std::atomic<uint32_t> failed{0};
+};
+static BleAckCounters gBleAckCounters;
+static Seqlock<ConnProfileMetrics> gConnMetrics;  // written under gLinkMetricsLock
+static esp_timer_handle_t gConnIdleTimer = nullptr;
+static std::atomic<uint32_t> gConnActivityMs{0};  // last write (ms since boot), read by the idle timer
+static std::atomic<bool> gConnBurst{false};       // between an idle->active switch and the idle timer
 static uint8_t gBleAddrType = 0;
-static uint16_t gBleConnHandle = BLE_HS_CONN_HANDLE_NONE;
+static std::atomic<uint16_t> gBleConnHandle{BLE_HS_CONN_HANDLE_NONE};  // written by the NimBLE host task
 static bool gBleAdvertising = false;
 static AdvProfile gAdvProfile = AdvProfile::kFastReconnect;
+static Seqlock<AdvSchedulerMetrics> gAdvSched;  // written by the NimBLE host task only
+static int64_t gAdvDisconnectUs = 0;
 static esp_power_level_t gBleTxPowerTarget = kBleTxPowerDefault;
 static bool gPmConfigured = false;
+static bool gPmLightSleep = kPmLightSleepDefault;
 static bool gPmConfigureAttempted = false;
 static esp_err_t gPmConfigureErr = ESP_OK;
 static bool gBleAddrValid = false;
 static uint8_t gBleAddr[6] = {};
-static RuntimeMetrics gMetrics;
-static CpuMetrics gCpuMetrics;
-static portMUX_TYPE gMetricsMux = portMUX_INITIALIZER_UNLOCKED;
+static Seqlock<RuntimeMetrics> gMetrics;
+static SemaphoreHandle_t gLinkMetricsLock = nullptr;
+static SemaphoreHandle_t gTxBenchLock = nullptr;  // one txbench run at a time
+static Seqlock<CpuMetrics> gCpuMetrics;       // written by the metrics task only
+static Seqlock<TxLeadMetrics> gTxLeadMetrics;  // written by the TX worker only
+static Seqlock<PreambleMetrics> gPreambleMetrics;  // written by the TX worker only
+static Seqlock<TaskCpuSnapshot> gTaskCpu;      // written by the metrics task only
+static TxPipelineCounters gTxCounters;
 
-static void process_input_payload(const std::string& payload, InputSource source);
+static void process_input_payload(std::string_view payload, InputSource source);
 static int ble_gap_event(struct ble_gap_event* event, void* arg);
 static void start_ble_advertising(AdvProfile profile);
 static void log_ble_status();
+static void log_ble_link(const char* reason);
+static void ble_conn_note_activity();
+static void log_conn_profile(const char* reason);
 static void log_runtime_metrics(const char* reason);
+static void log_adv_scheduler(const char* reason);
 static void log_pm_locks();
 static void configure_ble_tx_power();
-static bool parse_ble_tx_power_dbm(const std::string& token, esp_power_level_t* outLevel);
+static bool ble_tx_power_level_from_dbm(int32_t dbm, esp_power_level_t* outLevel);
 static void log_ble_tx_power_status();
 
 static int ble_tx_power_dbm(esp_power_level_t level) {
@@ -172,23 +977,10 @@ static int ble_tx_power_dbm(esp_power_level_t level) {
   }
 }
 
-static bool parse_ble_tx_power_dbm(const std::string& token, esp_power_level_t* outLevel) {
+static bool ble_tx_power_level_from_dbm(int32_t dbm, esp_power_level_t* outLevel) {
   if (outLevel == nullptr) {
     return false;
   }
-  if (token.empty()) {
-    return false;
-  }
-  char* end = nullptr;
-  errno = 0;
-  const long parsed = std::strtol(token.c_str(), &end, 10);
-  if (errno != 0 || end == token.c_str() || *end != '\0') {
-    return false;
-  }
-  if (parsed < -24 || parsed > 20) {
-    return false;
-  }
-  const int dbm = static_cast<int>(parsed);
   switch (dbm) {
     case -24: *outLevel = ESP_PWR_LVL_N24; return true;
     case -21: *outLevel = ESP_PWR_LVL_N21; return true;
@@ -219,20 +1011,69 @@ static void log_ble_tx_power_status() {
 
 static void cpu_metrics_sample() {
   const int mhz = esp_clk_cpu_freq() / 1000000;
-  portENTER_CRITICAL(&gMetricsMux);
-  gCpuMetrics.samples++;
-  if (mhz <= 40) {
-    gCpuMetrics.mhz40++;
-  } else if (mhz <= 80) {
-    gCpuMetrics.mhz80++;
-  } else if (mhz <= 160) {
-    gCpuMetrics.mhz160++;
-  } else if (mhz <= 240) {
-    gCpuMetrics.mhz240++;
-  } else {
-    gCpuMetrics.mhzOther++;
+  gCpuMetrics.write([mhz](CpuMetrics& cpu) {
+    cpu.samples++;
+    if (mhz <= 40) {
+      cpu.mhz40++;
+    } else if (mhz <= 80) {
+      cpu.mhz80++;
+    } else if (mhz <= 160) {
+      cpu.mhz160++;
+    } else if (mhz <= 240) {
+      cpu.mhz240++;
+    } else {
+      cpu.mhzOther++;
+    }
+  });
+}
+
+static uint32_t permille(uint64_t part, uint64_t whole) {
+  return whole == 0 ? 0 : static_cast<uint32_t>(part * 1000ULL / whole);
+}
+
+// Runs on the metrics task only; the status buffer is static so sampling
+// does not allocate.
+static void task_cpu_sample() {
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS && CONFIG_FREERTOS_USE_TRACE_FACILITY
+  static TaskStatus_t taskStats[kMaxTaskStats];
+  uint32_t totalRuntime = 0;
+  const UBaseType_t populated = uxTaskGetSystemState(taskStats, kMaxTaskStats, &totalRuntime);
+  const uint64_t capacity = static_cast<uint64_t>(totalRuntime) * static_cast<uint64_t>(portNUM_PROCESSORS);
+  TaskCpuSnapshot snapshot;
+  if (populated > 0 && capacity > 0) {
+    uint64_t idleRuntime = 0;
+    uint32_t topRuntime[pager_proto::kMetricsMaxTasks] = {};
+    for (UBaseType_t i = 0; i < populated; ++i) {
+      const TaskStatus_t& task = taskStats[i];
+      if (std::strncmp(task.pcTaskName, "IDLE", 4) == 0) {
+        idleRuntime += task.ulRunTimeCounter;
+        continue;
+      }
+      // Insertion into the small sorted top-N list.
+      size_t pos = snapshot.count;
+      while (pos > 0 && topRuntime[pos - 1] < task.ulRunTimeCounter) {
+        if (pos < pager_proto::kMetricsMaxTasks) {
+          topRuntime[pos] = topRuntime[pos - 1];
+          snapshot.tasks[pos] = snapshot.tasks[pos - 1];
+        }
+        --pos;
+      }
+      if (pos >= pager_proto::kMetricsMaxTasks) {
+        continue;
+      }
+      topRuntime[pos] = task.ulRunTimeCounter;
+      std::strncpy(snapshot.tasks[pos].name, task.pcTaskName, pager_proto::kMetricsTaskNameBytes);
+      snapshot.tasks[pos].cpuPermille = static_cast<uint16_t>(permille(task.ulRunTimeCounter, capacity));
+      if (snapshot.count < pager_proto::kMetricsMaxTasks) {
+        snapshot.count++;
+      }
+    }
+    const uint32_t idlePermille = permille(idleRuntime, capacity);
+    snapshot.busyPermille = static_cast<uint16_t>(idlePermille >= 1000 ? 0 : 1000 - idlePermille);
+    snapshot.valid = true;
   }
-  portEXIT_CRITICAL(&gMetricsMux);
+  gTaskCpu.write([&snapshot](TaskCpuSnapshot& value) { value = snapshot; });
+#endif
 }
 
 static void set_user_led(bool on) {
@@ -283,54 +1124,187 @@ static void set_idle_line(int gpio, OutputMode output, bool idleHigh) {
   cfg.mode = output == OutputMode::kOpenDrain ? GPIO_MODE_OUTPUT_OD : GPIO_MODE_OUTPUT;
   ESP_ERROR_CHECK(gpio_config(&cfg));
   ESP_ERROR_CHECK(gpio_set_level(static_cast<gpio_num_t>(gpio), idleHigh ? 1 : 0));
+  // Keep driving the idle level through light sleep instead of the pad's
+  // sleep configuration, which would let the pager input float.
+  gpio_sleep_sel_dis(static_cast<gpio_num_t>(gpio));
+}
+
+// Custom RMT encoder that generates symbols on demand and pushes them through a
+// copy encoder into the channel's ping-pong memory, so memory use does not grow
+// with transmission length. The primary data passed to rmt_transmit() is a
+// WaveStreamInput. encode() runs from the RMT ISR; it must not log or allocate.
+struct StreamingWaveEncoder {
+  rmt_encoder_t base;
+  rmt_encoder_handle_t copy;
+  BitRunSymbolSource source;
+  rmt_symbol_word_t pending;
+  bool hasPending;
+  bool started;
+};
+
+static size_t streaming_encoder_encode(rmt_encoder_t* encoder, rmt_channel_handle_t channel, const void* primaryData,
+                                       size_t, rmt_encode_state_t* retState) {
+  StreamingWaveEncoder* self = __containerof(encoder, StreamingWaveEncoder, base);
+  if (!self->started) {
+    self->source.reset(*static_cast<const WaveStreamInput*>(primaryData));
+    self->hasPending = false;
+    self->started = true;
+  }
+
+  size_t encoded = 0;
+  int state = RMT_ENCODING_RESET;
+  while (true) {
+    if (!self->hasPending) {
+      if (!self->source.next(&self->pending.val)) {
+        self->started = false;
+        state |= RMT_ENCODING_COMPLETE;
+        break;
+      }
+      self->hasPending = true;
+    }
+    rmt_encode_state_t session = RMT_ENCODING_RESET;
+    encoded += self->copy->encode(self->copy, channel, &self->pending, sizeof(rmt_symbol_word_t), &session);
+    if (session & RMT_ENCODING_COMPLETE) {
+      self->hasPending = false;
+    }
+    if (session & RMT_ENCODING_MEM_FULL) {
+      state |= RMT_ENCODING_MEM_FULL;
+      break;
+    }
+  }
+  *retState = static_cast<rmt_encode_state_t>(state);
+  return encoded;
+}
+
+static esp_err_t streaming_encoder_reset(rmt_encoder_t* encoder) {
+  StreamingWaveEncoder* self = __containerof(encoder, StreamingWaveEncoder, base);
+  self->hasPending = false;
+  self->started = false;
+  return rmt_encoder_reset(self->copy);
+}
+
+static esp_err_t streaming_encoder_del(rmt_encoder_t* encoder) {
+  StreamingWaveEncoder* self = __containerof(encoder, StreamingWaveEncoder, base);
+  const esp_err_t err = rmt_del_encoder(self->copy);
+  delete self;
+  return err;
+}
+
+static esp_err_t new_streaming_wave_encoder(rmt_encoder_handle_t* outEncoder) {
+  StreamingWaveEncoder* self = new StreamingWaveEncoder{};
+  rmt_copy_encoder_config_t copy_encoder_cfg = {};
+  const esp_err_t err = rmt_new_copy_encoder(&copy_encoder_cfg, &self->copy);
+  if (err != ESP_OK) {
+    delete self;
+    return err;
+  }
+  self->base.encode = streaming_encoder_encode;
+  self->base.reset = streaming_encoder_reset;
+  self->base.del = streaming_encoder_del;
+  *outEncoder = &self->base;
+  return ESP_OK;
 }
 
 class WaveTx {
  public:
   ~WaveTx() { shutdown_rmt(); }
 
-  bool transmit_bits(const std::vector<uint8_t>& bits, const Config& cfg) {
-    if (busy_) {
+  // Completion of each started frame sets `bits` in `task`'s notification value
+  // from the RMT on_trans_done callback.
+  void set_done_notify(TaskHandle_t task, uint32_t bits) {
+    doneTask_ = task;
+    doneBits_ = bits;
+  }
+
+  // Starts streaming the whole frame as a single RMT transaction and returns
+  // without waiting; symbols are generated by the streaming encoder as channel
+  // memory drains. `frame` must stay untouched until finish_frame(). With
+  // cfg.keepRmtChannel the channel and encoder survive the job and are only
+  // disabled, which drops the driver's PM lock while the RMT keeps the line
+  // parked at eot (idle) level.
+  bool start_frame(const PocsagFrame& frame, const Config& cfg) {
+    if (busy_ || frame.bits.empty()) {
       return false;
     }
-    if (bits.empty()) {
-      set_idle_line(cfg.dataGpio, cfg.output, cfg.idleHigh);
-      return true;
-    }
 
-    const uint32_t bitPeriodUs = (1000000 + (cfg.baud / 2)) / cfg.baud;
-    build_items(bits, bitPeriodUs, cfg.driveOneLow);
-    if (items_.empty()) {
+    busy_ = true;
+    lastStartWarm_ = channel_ != nullptr && channelGpio_ == cfg.dataGpio && channelOutput_ == cfg.output;
+    if (!lastStartWarm_ && !ensure_rmt(cfg.dataGpio, cfg.output, cfg.idleHigh)) {
+      busy_ = false;
       return false;
     }
+    channelIdleHigh_ = cfg.idleHigh;
 
-    busy_ = true;
-    const bool configured = ensure_rmt(cfg.dataGpio, cfg.output, cfg.idleHigh);
-    if (!configured) {
+    esp_err_t err = rmt_enable(channel_);
+    if (err != ESP_OK) {
+      ESP_LOGE(kTag, "rmt_enable failed: 0x%x", err);
+      release();
       busy_ = false;
       return false;
     }
 
+    const uint32_t baud = frame.baud != 0 ? frame.baud : cfg.baud;
+    input_ = {&frame.bits, (1000000 + (baud / 2)) / baud, cfg.driveOneLow};
     rmt_transmit_config_t tx_cfg = {};
     tx_cfg.loop_count = 0;
     tx_cfg.flags.eot_level = cfg.idleHigh ? 1 : 0;
 
-    esp_err_t err = rmt_transmit(channel_, encoder_, items_.data(),
-                                 items_.size() * sizeof(rmt_symbol_word_t), &tx_cfg);
-    if (err == ESP_OK) {
-      err = rmt_tx_wait_all_done(channel_, -1);
-    }
+    err = rmt_transmit(channel_, encoder_, &input_, sizeof(input_), &tx_cfg);
+    lastStartUs_ = esp_timer_get_time();
     if (err != ESP_OK) {
       ESP_LOGE(kTag, "rmt_transmit failed: 0x%x", err);
+      rmt_disable(channel_);
+      release();
+      busy_ = false;
+      return false;
     }
+    return true;
+  }
 
-    shutdown_rmt();
-    set_idle_line(cfg.dataGpio, cfg.output, cfg.idleHigh);
+  // Call once the done notification arrived for the frame started last.
+  bool finish_frame(const Config& cfg) {
+    if (!busy_) {
+      return false;
+    }
+    const esp_err_t err = rmt_tx_wait_all_done(channel_, 0);
+    if (err != ESP_OK) {
+      ESP_LOGE(kTag, "rmt_tx_wait_all_done failed: 0x%x", err);
+    }
+    const esp_err_t disableErr = rmt_disable(channel_);
+    if (disableErr != ESP_OK && disableErr != ESP_ERR_INVALID_STATE) {
+      ESP_LOGW(kTag, "rmt_disable failed: 0x%x", disableErr);
+    }
+    if (!cfg.keepRmtChannel || err != ESP_OK) {
+      release();
+    }
+    input_ = {};
     busy_ = false;
     return err == ESP_OK;
   }
 
+  // Frees a kept channel and hands the line back to plain GPIO at idle level.
+  void release() {
+    if (channel_ == nullptr) {
+      return;
+    }
+    shutdown_rmt();
+    set_idle_line(channelGpio_, channelOutput_, channelIdleHigh_);
+  }
+
+  bool holding_channel() const { return channel_ != nullptr; }
+  bool last_start_warm() const { return lastStartWarm_; }
+  int64_t last_start_us() const { return lastStartUs_; }
+
  private:
+  static bool IRAM_ATTR on_trans_done(rmt_channel_handle_t, const rmt_tx_done_event_data_t*, void* ctx) {
+    WaveTx* self = static_cast<WaveTx*>(ctx);
+    BaseType_t woken = pdFALSE;
+    if (self->doneTask_ != nullptr) {
+      xTaskNotifyFromISR(self->doneTask_, self->doneBits_, eSetBits, &woken);
+    }
+    return woken == pdTRUE;
+  }
+
   bool ensure_rmt(int gpio, OutputMode output, bool idleHigh) {
     shutdown_rmt();
 
@@ -339,7 +1313,7 @@ class WaveTx {
     tx_channel_cfg.gpio_num = static_cast<gpio_num_t>(gpio);
     tx_channel_cfg.clk_src = RMT_CLK_SRC_DEFAULT;
     tx_channel_cfg.resolution_hz = 1000000;
-    tx_channel_cfg.mem_block_symbols = 128;
+    tx_channel_cfg.mem_block_symbols = kRmtMemBlockSymbols;
     tx_channel_cfg.trans_queue_depth = 1;
     tx_channel_cfg.flags.io_od_mode = output == OutputMode::kOpenDrain;
 
@@ -349,21 +1323,24 @@ class WaveTx {
       return false;
     }
 
-    rmt_copy_encoder_config_t copy_encoder_cfg = {};
-    err = rmt_new_copy_encoder(&copy_encoder_cfg, &encoder_);
+    err = new_streaming_wave_encoder(&encoder_);
     if (err != ESP_OK) {
-      ESP_LOGE(kTag, "rmt_new_copy_encoder failed: 0x%x", err);
+      ESP_LOGE(kTag, "streaming encoder create failed: 0x%x", err);
       shutdown_rmt();
       return false;
     }
 
-    err = rmt_enable(channel_);
+    rmt_tx_event_callbacks_t callbacks = {};
+    callbacks.on_trans_done = on_trans_done;
+    err = rmt_tx_register_event_callbacks(channel_, &callbacks, this);
     if (err != ESP_OK) {
-      ESP_LOGE(kTag, "rmt_enable failed: 0x%x", err);
+      ESP_LOGE(kTag, "rmt_tx_register_event_callbacks failed: 0x%x", err);
       shutdown_rmt();
       return false;
     }
 
+    channelGpio_ = gpio;
+    channelOutput_ = output;
     initialized_ = true;
     return true;
   }
@@ -391,189 +1368,525 @@ class WaveTx {
     initialized_ = false;
   }
 
-  void build_items(const std::vector<uint8_t>& bits, uint32_t bitPeriodUs, bool driveOneLow) {
-    items_.clear();
-    size_t index = 0;
-
-    while (index < bits.size()) {
-      const uint8_t value = bits[index];
-      size_t runLength = 1;
-      while ((index + runLength) < bits.size() && bits[index + runLength] == value) {
-        ++runLength;
-      }
-
-      uint32_t totalDuration = static_cast<uint32_t>(runLength) * bitPeriodUs;
-      const bool levelHigh = driveOneLow ? (value == 0) : (value != 0);
-      while (totalDuration > 0) {
-        const uint32_t chunk = totalDuration > kMaxRmtDuration ? kMaxRmtDuration : totalDuration;
-        rmt_symbol_word_t item = {};
-        item.duration0 = chunk > 1 ? chunk - 1 : 1;
-        item.level0 = levelHigh;
-        item.duration1 = 1;
-        item.level1 = levelHigh;
-        items_.push_back(item);
-
-        if (items_.size() > kMaxRmtItems) {
-          ESP_LOGE(kTag, "RMT item overflow");
-          items_.clear();
-          return;
-        }
-        totalDuration -= chunk;
-      }
-      index += runLength;
-    }
-  }
-
   rmt_channel_handle_t channel_ = nullptr;
   rmt_encoder_handle_t encoder_ = nullptr;
   bool initialized_ = false;
   bool busy_ = false;
-  std::vector<rmt_symbol_word_t> items_;
+  int channelGpio_ = -1;
+  OutputMode channelOutput_ = OutputMode::kPushPull;
+  bool channelIdleHigh_ = true;
+  bool lastStartWarm_ = false;
+  int64_t lastStartUs_ = 0;
+  WaveStreamInput input_ = {};
+  TaskHandle_t doneTask_ = nullptr;
+  uint32_t doneBits_ = 0;
 };
 
-class PocsagEncoder {
- public:
-  std::vector<uint32_t> build_batch_words(uint32_t capcode, uint8_t functionBits,
-                                          const std::string& message) const {
-    std::vector<uint32_t> words(16, kIdleWord);
-    const uint8_t frame = static_cast<uint8_t>(capcode & 0x7);
-    size_t index = static_cast<size_t>(frame) * 2;
-    words[index++] = build_address_word(capcode, functionBits);
-
-    for (const uint32_t messageWord : build_alpha_words(message)) {
-      if (index >= words.size()) {
-        break;
-      }
-      words[index++] = messageWord;
-    }
-    return words;
+static WaveTx gWaveTx;
+
+static std::string_view trim_view(std::string_view in) {
+  while (!in.empty() && std::isspace(static_cast<unsigned char>(in.front())) != 0) {
+    in.remove_prefix(1);
+  }
+  while (!in.empty() && std::isspace(static_cast<unsigned char>(in.back())) != 0) {
+    in.remove_suffix(1);
   }
+  return in;
+}
 
- private:
-  std::vector<uint32_t> build_alpha_words(const std::string& message) const {
-    std::vector<uint8_t> bits;
-    bits.reserve(message.size() * 7);
-    for (char c : message) {
-      const uint8_t value = static_cast<uint8_t>(c) & 0x7F;
-      for (int b = 0; b < 7; ++b) {
-        bits.push_back((value >> b) & 0x1);
-      }
+// Case-insensitive match of `line` against `word` alone or `word` followed by
+// a space; on a match `rest` is the trimmed remainder (may be empty).
+static bool match_command_word(std::string_view line, std::string_view word, std::string_view* rest) {
+  if (line.size() < word.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < word.size(); ++i) {
+    if (std::tolower(static_cast<unsigned char>(line[i])) != word[i]) {
+      return false;
     }
+  }
+  if (line.size() > word.size() && line[word.size()] != ' ') {
+    return false;
+  }
+  *rest = trim_view(line.substr(word.size()));
+  return true;
+}
 
-    std::vector<uint32_t> words;
-    size_t index = 0;
-    while (index < bits.size()) {
-      uint32_t data = 0;
-      for (int i = 0; i < 20; ++i) {
-        data <<= 1;
-        if (index < bits.size()) {
-          data |= bits[index++];
-        }
+// Greedily packs pending jobs into one transmission, always taking the most
+// urgent job and, within a priority, the one whose frame is reached soonest
+// (earliest-queued wins ties, keeping per-capcode order). Jobs are grouped by
+// frame slot: the gap to each of the 8 frames is worked out once per pick and
+// shared by every job addressed to that frame. The first job taken sets the
+// baud; jobs for another baud wait for a later transmission.
+// Packed jobs are moved from `pending` to `sent`; jobs that did not fit stay
+// pending. Sets frame.baud; the bits are written by encode_packed_frame.
+static void pack_pending_jobs(std::vector<TxJob*>& pending, std::vector<TxJob*>& sent, const Config& cfg,
+                              PocsagBatchPacker& packer, PocsagFrame& frame) {
+  frame.baud = 0;
+  packer.reset(cfg.maxBatches);
+  std::array<size_t, pocsag::kFramesPerBatch> slotGap = {};
+  while (!pending.empty()) {
+    for (size_t slot = 0; slot < slotGap.size(); ++slot) {
+      slotGap[slot] = packer.gap_for_slot(slot);
+    }
+    size_t best = pending.size();
+    TxPriority bestPriority = TxPriority::kLow;
+    size_t bestGap = 0;
+    for (size_t i = 0; i < pending.size(); ++i) {
+      const uint32_t baud = pending[i]->baud != 0 ? pending[i]->baud : cfg.baud;
+      if (frame.baud != 0 && baud != frame.baud) {
+        continue;
       }
-      words.push_back(encode_codeword((1u << 20) | (data & 0xFFFFF)));
+      const TxPriority priority = pending[i]->priority;
+      const size_t gap = slotGap[pocsag::frame_slot(pending[i]->capcode)];
+      if (best == pending.size() || priority < bestPriority || (priority == bestPriority && gap < bestGap)) {
+        best = i;
+        bestPriority = priority;
+        bestGap = gap;
+      }
+    }
+    if (best == pending.size()) {
+      break;
     }
-    if (words.empty()) {
-      words.push_back(encode_codeword(1u << 20));
+    TxJob* job = pending[best];
+    if (!packer.add(job->capcode, job->functionBits, job->text, job->length)) {
+      break;
     }
-    return words;
+    frame.baud = job->baud != 0 ? job->baud : cfg.baud;
+    sent.push_back(job);
+    pending.erase(pending.begin() + static_cast<std::ptrdiff_t>(best));
   }
+}
 
-  uint32_t build_address_word(uint32_t capcode, uint8_t functionBits) const {
-    const uint32_t address = capcode >> 3;
-    const uint32_t data = ((address & 0x3FFFF) << 2) | (functionBits & 0x3);
-    return encode_codeword(data & 0x1FFFFF);
-  }
+// Preamble followed by the batches held in the packer.
+static void encode_packed_frame(const Config& cfg, uint32_t preambleBits, const PocsagBatchPacker& packer,
+                                PocsagFrame& frame) {
+  frame.bits.clear();
+  frame.preambleBits = preambleBits;
+  frame.bits.reserve_bits(preambleBits + kBatchBits);
+  pocsag::append_preamble(frame.bits, preambleBits);
+  const uint32_t invertMask = cfg.invertWords ? 0xFFFFFFFFu : 0u;
+  frame.batches = packer.finish(frame.bits, invertMask);
+  frame.truncated = packer.truncated();
+}
 
-  uint32_t encode_codeword(uint32_t msg21) const {
-    uint32_t reg = msg21 << 10;
-    constexpr uint32_t poly = 0x769;
-    for (int i = 30; i >= 10; --i) {
-      if (reg & (1u << i)) {
-        reg ^= (poly << (i - 10));
-      }
-    }
-    const uint32_t remainder = reg & 0x3FF;
-    uint32_t word = (msg21 << 11) | (remainder << 1);
-    word |= static_cast<uint32_t>(__builtin_parity(word));
-    return word;
-  }
+static void build_packed_frame(std::vector<TxJob*>& pending, std::vector<TxJob*>& sent, const Config& cfg,
+                               uint32_t preambleBits, PocsagBatchPacker& packer, PocsagFrame& frame) {
+  pack_pending_jobs(pending, sent, cfg, packer, frame);
+  encode_packed_frame(cfg, preambleBits, packer, frame);
+}
+
+enum class TxEventType : uint8_t { kDone = 0, kFail = 1, kQueued = 2, kOnAir = 3, kDropped = 4, kCoalesced = 5 };
+
+// Lifecycle events for pages. kQueued/kDropped/kCoalesced are published by the
+// producer that enqueued the page; kOnAir/kDone/kFail by the TX worker task
+// (transmission started, finished or failed to start). `jobs` is only valid
+// for the duration of the listener call.
+struct TxEvent {
+  TxEventType type;
+  const TxJob* const* jobs;
+  size_t jobCount;
+  size_t batches;
+  uint32_t leadUs;
+  uint32_t airtimeUs;
 };
 
-static PocsagEncoder gEncoder;
-static WaveTx gWaveTx;
+using TxEventListener = void (*)(const TxEvent& event, void* arg);
 
-static std::string trim_copy(const std::string& in) {
-  size_t start = 0;
-  while (start < in.size() && std::isspace(static_cast<unsigned char>(in[start])) != 0) {
-    ++start;
+struct TxEventSubscription {
+  TxEventListener listener;
+  void* arg;
+};
+
+constexpr size_t kMaxTxEventListeners = 4;
+static TxEventSubscription gTxEventListeners[kMaxTxEventListeners] = {};
+static size_t gTxEventListenerCount = 0;
+static portMUX_TYPE gTxEventMux = portMUX_INITIALIZER_UNLOCKED;
+
+static bool tx_events_subscribe(TxEventListener listener, void* arg) {
+  bool added = false;
+  portENTER_CRITICAL(&gTxEventMux);
+  if (gTxEventListenerCount < kMaxTxEventListeners) {
+    gTxEventListeners[gTxEventListenerCount++] = {listener, arg};
+    added = true;
   }
-  size_t end = in.size();
-  while (end > start && std::isspace(static_cast<unsigned char>(in[end - 1])) != 0) {
-    --end;
+  portEXIT_CRITICAL(&gTxEventMux);
+  return added;
+}
+
+static void tx_events_publish(const TxEvent& event) {
+  TxEventSubscription listeners[kMaxTxEventListeners] = {};
+  size_t count = 0;
+  portENTER_CRITICAL(&gTxEventMux);
+  count = gTxEventListenerCount;
+  for (size_t i = 0; i < count; ++i) {
+    listeners[i] = gTxEventListeners[i];
+  }
+  portEXIT_CRITICAL(&gTxEventMux);
+  for (size_t i = 0; i < count; ++i) {
+    listeners[i].listener(event, listeners[i].arg);
   }
-  return in.substr(start, end - start);
 }
 
-static std::string to_lower_copy(std::string in) {
-  for (char& c : in) {
-    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+static void log_tx_event(const TxEvent& event, void*) {
+  if (event.type != TxEventType::kDone && event.type != TxEventType::kFail) {
+    return;
   }
-  return in;
+  ESP_LOGI(kTag, "%s (pages=%u batches=%u lead=%luus air=%lums)",
+           event.type == TxEventType::kDone ? "TX_DONE" : "TX_FAIL",
+           static_cast<unsigned>(event.jobCount), static_cast<unsigned>(event.batches),
+           static_cast<unsigned long>(event.leadUs), static_cast<unsigned long>(event.airtimeUs / 1000));
 }
 
-static std::vector<uint8_t> build_pocsag_bits(const std::string& message, const Config& cfg) {
-  std::vector<uint8_t> bits;
-  bits.reserve(cfg.preambleBits + 544);
+static void count_tx_event(const TxEvent& event, void*) {
+  const uint32_t pages = static_cast<uint32_t>(event.jobCount);
+  switch (event.type) {
+    case TxEventType::kDone:
+      gTxCounters.sent.fetch_add(pages, std::memory_order_relaxed);
+      gTxCounters.airtimeMs.fetch_add(event.airtimeUs / 1000, std::memory_order_relaxed);
+      break;
+    case TxEventType::kFail:
+      gTxCounters.failed.fetch_add(pages, std::memory_order_relaxed);
+      break;
+    case TxEventType::kDropped:
+      gTxCounters.dropped.fetch_add(pages, std::memory_order_relaxed);
+      break;
+    case TxEventType::kCoalesced:
+      gTxCounters.coalesced.fetch_add(pages, std::memory_order_relaxed);
+      break;
+    case TxEventType::kQueued:  // published before the push; enqueue_page counts accepted pages
+    case TxEventType::kOnAir:
+      break;
+  }
+}
 
-  for (uint32_t i = 0; i < cfg.preambleBits; ++i) {
-    bits.push_back(static_cast<uint8_t>(i % 2 == 0));
+static void publish_job_event(TxEventType type, const TxJob* job) {
+  TxEvent event = {};
+  event.type = type;
+  event.jobs = &job;
+  event.jobCount = 1;
+  tx_events_publish(event);
+}
+
+static pager_proto::Stage delivery_stage(TxEventType type) {
+  switch (type) {
+    case TxEventType::kQueued: return pager_proto::Stage::kQueued;
+    case TxEventType::kOnAir: return pager_proto::Stage::kOnAir;
+    case TxEventType::kDone: return pager_proto::Stage::kTxDone;
+    case TxEventType::kFail: return pager_proto::Stage::kTxFail;
+    case TxEventType::kDropped: return pager_proto::Stage::kDropped;
+    case TxEventType::kCoalesced: return pager_proto::Stage::kCoalesced;
   }
+  return pager_proto::Stage::kTxFail;
+}
 
-  uint32_t sync = cfg.invertWords ? ~kSyncWord : kSyncWord;
-  for (int i = 31; i >= 0; --i) {
-    bits.push_back((sync >> i) & 0x1);
+// Reports page stages to a subscribed BLE client as status notifications
+// (format in pager_protocol.h). Pages without a msg id are not reported. The
+// handle is sampled once; a disconnect racing past this check makes the
+// notify fail (counted in `failed`) rather than reach another link.
+static void ble_notify_tx_event(const TxEvent& event, void*) {
+  const uint16_t connHandle = gBleConnHandle.load(std::memory_order_acquire);
+  if (connHandle == BLE_HS_CONN_HANDLE_NONE || !gBleStatusSubscribed.load(std::memory_order_acquire)) {
+    return;
+  }
+  const uint16_t mtu = gBleLink.read().mtu;
+  const size_t payloadMax = mtu > 3 ? mtu - 3 : 0;
+  if (payloadMax < pager_proto::kStatusHeaderBytes + pager_proto::kStatusEntryBytes) {
+    return;
+  }
+  size_t perNotify = (payloadMax - pager_proto::kStatusHeaderBytes) / pager_proto::kStatusEntryBytes;
+  if (perNotify > kMaxPackedPages) {
+    perNotify = kMaxPackedPages;
   }
 
-  auto words = gEncoder.build_batch_words(cfg.capInd, cfg.functionBits, message);
-  for (uint32_t& word : words) {
-    if (cfg.invertWords) {
-      word = ~word;
+  const pager_proto::Stage stage = delivery_stage(event.type);
+  const size_t depth = gTxScheduler.depth();
+  const uint8_t queueDepth = static_cast<uint8_t>(depth > 0xFF ? 0xFF : depth);
+  const uint32_t timeMs = static_cast<uint32_t>(esp_timer_get_time() / 1000);
+  uint8_t buffer[pager_proto::kStatusHeaderBytes + kMaxPackedPages * pager_proto::kStatusEntryBytes];
+  size_t index = 0;
+  while (index < event.jobCount) {
+    uint8_t count = 0;
+    for (; index < event.jobCount && count < perNotify; ++index) {
+      const TxJob* job = event.jobs[index];
+      if (job->msgId == 0) {
+        continue;
+      }
+      pager_proto::write_status_entry(
+          buffer + pager_proto::kStatusHeaderBytes + count * pager_proto::kStatusEntryBytes, stage, job->msgId,
+          queueDepth, timeMs);
+      count++;
     }
-    for (int i = 31; i >= 0; --i) {
-      bits.push_back((word >> i) & 0x1);
+    if (count == 0) {
+      continue;
+    }
+    pager_proto::write_status_header(buffer, count);
+    const size_t length = pager_proto::kStatusHeaderBytes + count * pager_proto::kStatusEntryBytes;
+    os_mbuf* om = ble_hs_mbuf_from_flat(buffer, static_cast<uint16_t>(length));
+    const int rc = om == nullptr ? BLE_HS_ENOMEM : ble_gatts_notify_custom(connHandle, gBleStatusValHandle, om);
+    if (rc == 0) {
+      gBleAckCounters.notifies.fetch_add(1, std::memory_order_relaxed);
+      gBleAckCounters.entries.fetch_add(static_cast<uint32_t>(count), std::memory_order_relaxed);
+    } else {
+      gBleAckCounters.failed.fetch_add(1, std::memory_order_relaxed);
     }
   }
-  return bits;
 }
 
-static bool enqueue_message_page(const std::string& message, TickType_t waitTicks) {
-  const std::vector<uint8_t> bits = build_pocsag_bits(message, gConfig);
-  TxJob* job = new TxJob{bits};
-  if (xQueueSend(gTxQueue, &job, waitTicks) != pdTRUE) {
-    delete job;
-    ESP_LOGW(kTag, "Queue busy; dropped input");
+static bool enqueue_page(uint32_t capcode, uint8_t functionBits, uint32_t baud, TxPriority priority,
+                         uint16_t msgId, std::string_view message) {
+  TxJob* job = gTxJobPool.acquire();
+  if (job == nullptr) {
+    ESP_LOGW(kTag, "Job pool exhausted; dropped input");
+    if (msgId != 0) {
+      TxJob dropped;
+      dropped.msgId = msgId;
+      publish_job_event(TxEventType::kDropped, &dropped);
+    }
+    return false;
+  }
+  fill_tx_job(job, capcode, functionBits, baud, priority, msgId, message.data(), message.size());
+  // Reported before the push so the worker's on-air/done reports can never
+  // overtake it; a page the scheduler refuses is followed by dropped/coalesced.
+  publish_job_event(TxEventType::kQueued, job);
+  TxJob* evicted = nullptr;
+  const Config cfg = config_snapshot();
+  const TxEnqueueResult result = gTxScheduler.push(job, cfg.dropPolicy, cfg.coalesceWindowMs,
+                                                   esp_timer_get_time(), &evicted);
+  if (evicted != nullptr) {
+    ESP_LOGW(kTag, "Queue full (%s); dropped oldest: %s", tx_priority_label(evicted->priority), evicted->text);
+    publish_job_event(TxEventType::kDropped, evicted);
+    gTxJobPool.release(evicted);
+  }
+  if (result == TxEnqueueResult::kCoalesced) {
+    publish_job_event(TxEventType::kCoalesced, job);
+    gTxJobPool.release(job);
+    ESP_LOGI(kTag, "Coalesced duplicate: %.*s", static_cast<int>(message.size()), message.data());
+    return true;
+  }
+  if (result == TxEnqueueResult::kRejected) {
+    publish_job_event(TxEventType::kDropped, job);
+    gTxJobPool.release(job);
+    ESP_LOGW(kTag, "Queue full (%s); rejected input", tx_priority_label(priority));
     return false;
   }
-  ESP_LOGI(kTag, "Queued: %s", message.c_str());
+  gTxCounters.queued.fetch_add(1, std::memory_order_relaxed);
+  xTaskNotify(gTxWorkerTask, kTxNotifyJob, eSetBits);
+  ESP_LOGI(kTag, "Queued%s: %.*s", priority == TxPriority::kUrgent ? " (urgent)" : "",
+           static_cast<int>(message.size()), message.data());
   return true;
 }
 
+// Text pages go to the configured capcode unless they start with "@<id> ",
+// which routes them to that recipient profile.
+static bool enqueue_message_page(std::string_view message, TxPriority priority) {
+  if (!message.empty() && message.front() == '@') {
+    const size_t split = message.find(' ');
+    const std::string_view id = message.substr(1, split == std::string_view::npos ? split : split - 1);
+    const std::string_view text =
+        split == std::string_view::npos ? std::string_view() : trim_view(message.substr(split + 1));
+    char key[kProfileIdMax + 1];
+    RecipientProfile profile = {};
+    if (!parse_profile_id(id, key) || !find_profile(key, &profile)) {
+      ESP_LOGW(kTag, "Unknown profile @%.*s; page not queued", static_cast<int>(id.size()), id.data());
+      return false;
+    }
+    if (text.empty()) {
+      ESP_LOGW(kTag, "Empty page for @%s; not queued", profile.id);
+      return false;
+    }
+    return enqueue_page(profile.capcode, profile.functionBits, profile.baud, priority, 0, text);
+  }
+  const Config cfg = config_snapshot();
+  return enqueue_page(cfg.capInd, cfg.functionBits, 0, priority, 0, message);
+}
+
+// Queues every page record of one binary frame (see pager_protocol.h).
+static void process_binary_frame(const char* data, size_t length) {
+  pager_proto::FrameReader reader(data, length);
+  if (!reader.valid_header()) {
+    gBleBinaryMetrics.write([](BleBinaryMetrics& m) { m.badFrames++; });
+    ESP_LOGW(kTag, "BLE binary frame rejected (len=%u version=%u)", static_cast<unsigned>(length),
+             static_cast<unsigned>(reader.version()));
+    return;
+  }
+
+  const Config cfg = config_snapshot();
+  uint32_t pages = 0;
+  uint32_t badRecords = 0;
+  pager_proto::Record record = {};
+  pager_proto::ReadStatus status;
+  while ((status = reader.next(&record)) == pager_proto::ReadStatus::kRecord) {
+    if (record.opcode != pager_proto::Opcode::kPage && record.opcode != pager_proto::Opcode::kProfilePage) {
+      continue;
+    }
+    if (record.priority > pager_proto::kMaxPriority || record.payload.empty() || record.capcode > kCapcodeMax ||
+        (record.functionBits > 0x3 && record.functionBits != pager_proto::kDefaultFunction)) {
+      badRecords++;
+      ESP_LOGW(kTag, "BLE binary page id=%u rejected", static_cast<unsigned>(record.msgId));
+      continue;
+    }
+    uint32_t capcode = record.capcode == pager_proto::kDefaultCapcode ? cfg.capInd : record.capcode;
+    uint8_t functionBits = cfg.functionBits;
+    uint32_t baud = 0;
+    std::string_view text = record.payload;
+    if (record.opcode == pager_proto::Opcode::kProfilePage) {
+      std::string_view id;
+      char key[kProfileIdMax + 1];
+      RecipientProfile profile = {};
+      if (!pager_proto::split_profile_payload(record.payload, &id, &text) || text.empty() ||
+          !parse_profile_id(id, key) || !find_profile(key, &profile)) {
+        badRecords++;
+        ESP_LOGW(kTag, "BLE binary page id=%u: unknown profile or empty text", static_cast<unsigned>(record.msgId));
+        continue;
+      }
+      capcode = profile.capcode;
+      functionBits = profile.functionBits;
+      baud = profile.baud;
+    }
+    if (record.functionBits != pager_proto::kDefaultFunction) {
+      functionBits = record.functionBits;
+    }
+    if (enqueue_page(capcode, functionBits, baud, static_cast<TxPriority>(record.priority), record.msgId, text)) {
+      pages++;
+    }
+  }
+  if (status == pager_proto::ReadStatus::kTruncated) {
+    badRecords++;
+    ESP_LOGW(kTag, "BLE binary frame truncated after %lu pages", static_cast<unsigned long>(pages));
+  }
+
+  gBleBinaryMetrics.write([&](BleBinaryMetrics& m) {
+    m.frames++;
+    m.pages += pages;
+    m.badRecords += badRecords;
+  });
+}
+
+// "off" unless the build counts operator new calls.
+static const char* cxx_allocs_text(uint32_t count, char (&buf)[12]) {
+  if (!kCountCxxAllocs) {
+    return "off";
+  }
+  std::snprintf(buf, sizeof(buf), "%lu", static_cast<unsigned long>(count));
+  return buf;
+}
+
+static void log_heap_snapshot(const char* label) {
+  multi_heap_info_t info = {};
+  heap_caps_get_info(&info, MALLOC_CAP_DEFAULT);
+  char allocs[12];
+  ESP_LOGI(kTag, "heap[%s]: free=%u largest=%u free_blocks=%u alloc_blocks=%u min_free=%u cxx_allocs=%s",
+           label, static_cast<unsigned>(info.total_free_bytes), static_cast<unsigned>(info.largest_free_block),
+           static_cast<unsigned>(info.free_blocks), static_cast<unsigned>(info.allocated_blocks),
+           static_cast<unsigned>(info.minimum_free_bytes),
+           cxx_allocs_text(gCxxHeapAllocs.load(std::memory_order_relaxed), allocs));
+}
+
+// Pushes synthetic pages through the pooled job + packer + frame path (no RF)
+// and logs heap state around it. Runs on the caller's task with its own job
+// pool, packer and frame so it does not disturb the TX worker; the statics are
+// only touched while gTxBenchLock is held.
+static void run_tx_bench(uint32_t pages) {
+  if (gTxBenchLock == nullptr || xSemaphoreTake(gTxBenchLock, 0) != pdTRUE) {
+    ESP_LOGW(kTag, "txbench: already running");
+    return;
+  }
+  static BasicTxJobPool<kMaxPackedPages> pool;
+  static PocsagBatchPacker packer;
+  static PocsagFrame frame;
+  static std::vector<TxJob*> pending;
+  static std::vector<TxJob*> sent;
+  pending.reserve(kMaxPackedPages);
+  sent.reserve(kMaxPackedPages);
+  frame.bits.reserve_bits(kMaxPreambleBits + kMaxBatchesLimit * kBatchBits);
+  const Config cfg = config_snapshot();
+
+  log_heap_snapshot("txbench before");
+  const uint32_t allocsBefore = gCxxHeapAllocs.load(std::memory_order_relaxed);
+  const int64_t startUs = esp_timer_get_time();
+  uint32_t frames = 0;
+  uint32_t poolMisses = 0;
+  char text[48];
+  for (uint32_t i = 0; i < pages; ++i) {
+    TxJob* job = pool.acquire();
+    if (job == nullptr) {
+      poolMisses++;
+    } else {
+      const int len = std::snprintf(text, sizeof(text), "BENCH %lu: the quick brown fox",
+                                    static_cast<unsigned long>(i));
+      fill_tx_job(job, cfg.capInd + (i & 0x7), cfg.functionBits, 0, TxPriority::kNormal, 0, text,
+                  len > 0 ? static_cast<size_t>(len) : 0);
+      pending.push_back(job);
+    }
+    const bool last = i + 1 == pages;
+    while (!pending.empty() && (pending.size() == kMaxPackedPages || last)) {
+      sent.clear();
+      build_packed_frame(pending, sent, cfg, cfg.preambleBits, packer, frame);
+      frames++;
+      for (TxJob* done : sent) {
+        pool.release(done);
+      }
+    }
+  }
+  const int64_t elapsedUs = esp_timer_get_time() - startUs;
+  const uint32_t allocs = gCxxHeapAllocs.load(std::memory_order_relaxed) - allocsBefore;
+  log_heap_snapshot("txbench after");
+  char allocsText[12];
+  ESP_LOGI(kTag, "txbench: pages=%lu frames=%lu pool_misses=%lu cxx_allocs=%s elapsed=%lldus (%lluus/page)",
+           static_cast<unsigned long>(pages), static_cast<unsigned long>(frames),
+           static_cast<unsigned long>(poolMisses), cxx_allocs_text(allocs, allocsText),
+           static_cast<long long>(elapsedUs),
+           static_cast<unsigned long long>(pages == 0 ? 0 : elapsedUs / pages));
+  xSemaphoreGive(gTxBenchLock);
+}
+
 static void log_status() {
-  const UBaseType_t queued = gTxQueue == nullptr ? 0 : uxQueueMessagesWaiting(gTxQueue);
-  ESP_LOGI(kTag, "status: capcode=%lu func=%u baud=%lu preamble=%lu",
-           static_cast<unsigned long>(gConfig.capInd),
-           static_cast<unsigned>(gConfig.functionBits),
-           static_cast<unsigned long>(gConfig.baud),
-           static_cast<unsigned long>(gConfig.preambleBits));
+  const size_t queued = gTxScheduler.depth();
+  const Config cfg = config_snapshot();
+  ESP_LOGI(kTag, "status: capcode=%lu func=%u baud=%lu preamble=%lu max_batches=%u",
+           static_cast<unsigned long>(cfg.capInd),
+           static_cast<unsigned>(cfg.functionBits),
+           static_cast<unsigned long>(cfg.baud),
+           static_cast<unsigned long>(cfg.preambleBits),
+           static_cast<unsigned>(cfg.maxBatches));
+  if (cfg.shortPreambleWindowMs == 0) {
+    ESP_LOGI(kTag, "status: short preamble off");
+  } else {
+    ESP_LOGI(kTag, "status: short preamble=%lu within %lums of the previous transmission",
+             static_cast<unsigned long>(cfg.shortPreambleBits),
+             static_cast<unsigned long>(cfg.shortPreambleWindowMs));
+  }
   ESP_LOGI(kTag, "status: gpio=%d output=%s idle=%s driveOneLow=%s invertWords=%s queue=%lu",
-           gConfig.dataGpio,
-           gConfig.output == OutputMode::kOpenDrain ? "open-drain" : "push-pull",
-           gConfig.idleHigh ? "high" : "low",
-           gConfig.driveOneLow ? "yes" : "no",
-           gConfig.invertWords ? "yes" : "no",
+           cfg.dataGpio,
+           cfg.output == OutputMode::kOpenDrain ? "open-drain" : "push-pull",
+           cfg.idleHigh ? "high" : "low",
+           cfg.driveOneLow ? "yes" : "no",
+           cfg.invertWords ? "yes" : "no",
            static_cast<unsigned long>(queued));
+  ESP_LOGI(kTag, "status: queue policy=%s coalesce=%lums depth/level=%u",
+           cfg.dropPolicy == TxDropPolicy::kReject ? "reject" : "drop-oldest",
+           static_cast<unsigned long>(cfg.coalesceWindowMs),
+           static_cast<unsigned>(kTxQueueDepthPerPriority));
+  for (size_t level = 0; level < kTxPriorityCount; ++level) {
+    const TxPriority priority = static_cast<TxPriority>(level);
+    const TxQueueStats q = gTxScheduler.stats(priority);
+    ESP_LOGI(kTag, "status: queue[%s] depth=%lu hwm=%lu enq=%lu drop=%lu coalesce=%lu reject=%lu",
+             tx_priority_label(priority),
+             static_cast<unsigned long>(q.depth), static_cast<unsigned long>(q.highWater),
+             static_cast<unsigned long>(q.enqueued), static_cast<unsigned long>(q.dropped),
+             static_cast<unsigned long>(q.coalesced), static_cast<unsigned long>(q.rejected));
+  }
+  const TxJobPoolStats pool = gTxJobPool.stats();
+  ESP_LOGI(kTag, "status: job pool in_use=%lu/%lu hwm=%lu exhausted=%lu",
+           static_cast<unsigned long>(pool.inUse), static_cast<unsigned long>(pool.capacity),
+           static_cast<unsigned long>(pool.highWater), static_cast<unsigned long>(pool.exhausted));
+  ESP_LOGI(kTag, "status: rmt keep=%s release_idle=%lums channel=%s",
+           cfg.keepRmtChannel ? "yes" : "no",
+           static_cast<unsigned long>(cfg.rmtReleaseIdleMs),
+           gWaveTx.holding_channel() ? "held" : "released");
   ESP_LOGI(kTag, "status: ble connected=%s advertising=%s",
-           gBleConnHandle == BLE_HS_CONN_HANDLE_NONE ? "no" : "yes",
+           gBleConnHandle.load(std::memory_order_acquire) == BLE_HS_CONN_HANDLE_NONE ? "no" : "yes",
            gBleAdvertising ? "yes" : "no");
   ESP_LOGI(kTag, "status: ble tx_power target=%ddBm", ble_tx_power_dbm(gBleTxPowerTarget));
   if (gBleAddrValid) {
@@ -582,21 +1895,183 @@ static void log_status() {
   }
 }
 
+struct PmLockStats {
+  uint32_t acquisitions = 0;
+  uint64_t heldUs = 0;
+  uint32_t lastHeldUs = 0;
+  uint32_t maxHeldUs = 0;
+};
+
+// esp_pm_lock that records how long it is held. acquire()/release() must come
+// from a single task (the TX worker); other tasks read the stats through the
+// seqlock. Without PM support the lock is a no-op and nothing is counted.
+class PmLock {
+ public:
+  void create(esp_pm_lock_type_t type, const char* name) {
+    name_ = name;
+    const esp_err_t err = esp_pm_lock_create(type, 0, name, &handle_);
+    if (err != ESP_OK) {
+      handle_ = nullptr;
+      if (err != ESP_ERR_NOT_SUPPORTED) {
+        ESP_LOGW(kTag, "esp_pm_lock_create(%s) failed: 0x%x", name, err);
+      }
+    }
+  }
+
+  void acquire() {
+    if (handle_ == nullptr || held_) {
+      return;
+    }
+    if (esp_pm_lock_acquire(handle_) != ESP_OK) {
+      return;
+    }
+    held_ = true;
+    acquiredUs_ = esp_timer_get_time();
+  }
+
+  void release() {
+    if (!held_) {
+      return;
+    }
+    esp_pm_lock_release(handle_);
+    held_ = false;
+    const uint32_t heldUs = static_cast<uint32_t>(esp_timer_get_time() - acquiredUs_);
+    stats_.write([heldUs](PmLockStats& stats) {
+      stats.acquisitions++;
+      stats.heldUs += heldUs;
+      stats.lastHeldUs = heldUs;
+      if (heldUs > stats.maxHeldUs) {
+        stats.maxHeldUs = heldUs;
+      }
+    });
+  }
+
+  PmLockStats stats() const { return stats_.read(); }
+  const char* name() const { return name_; }
+
+ private:
+  esp_pm_lock_handle_t handle_ = nullptr;
+  const char* name_ = "";
+  bool held_ = false;
+  int64_t acquiredUs_ = 0;
+  Seqlock<PmLockStats> stats_;
+};
+
+class ScopedPmLock {
+ public:
+  explicit ScopedPmLock(PmLock& lock) : lock_(lock) { lock_.acquire(); }
+  ~ScopedPmLock() { lock_.release(); }
+  ScopedPmLock(const ScopedPmLock&) = delete;
+  ScopedPmLock& operator=(const ScopedPmLock&) = delete;
+
+ private:
+  PmLock& lock_;
+};
+
+// CPU at kPmMaxFreqMhz while a frame is packed/encoded and the RMT channel is
+// set up; APB pinned at its maximum from rmt_transmit until the frame is done
+// so the RMT bit clock cannot move mid-page. Between jobs DFS is free to idle
+// at kPmMinFreqMhz.
+// tx_busy (NO_LIGHT_SLEEP) is taken as soon as the worker wakes up with work
+// and dropped when it goes back to waiting with nothing queued or on air.
+static PmLock gTxCpuLock;
+static PmLock gTxApbLock;
+static PmLock gTxBusyLock;
+
+// Light-sleep entries and time asleep, from the PM sleep callbacks. Only one
+// core enters light sleep at a time, so there is a single writer. Microsecond
+// totals in 64 bits do not wrap in the device's lifetime. The exit callback
+// runs from IRAM with the flash cache off, so it updates gLightSleepSeq by
+// hand (inline atomics only) instead of calling Seqlock::write.
+struct LightSleepCounters {
+  uint32_t sleeps = 0;
+  uint64_t sleptUs = 0;
+  uint64_t longestUs = 0;
+};
+static std::atomic<uint32_t> gLightSleepSeq{0};
+static LightSleepCounters gLightSleep;
+
+static LightSleepCounters read_light_sleep() {
+  LightSleepCounters copy;
+  uint32_t before = 0;
+  do {
+    before = gLightSleepSeq.load(std::memory_order_acquire);
+    copy = gLightSleep;
+    std::atomic_thread_fence(std::memory_order_acquire);
+  } while ((before & 1U) != 0 || gLightSleepSeq.load(std::memory_order_relaxed) != before);
+  return copy;
+}
+
+// Queue-to-air latency per page, written by the TX worker only.
+struct TxLatencyMetrics {
+  uint32_t samples = 0;
+  uint64_t totalUs = 0;
+  uint32_t lastUs = 0;
+  uint32_t maxUs = 0;
+};
+static Seqlock<TxLatencyMetrics> gTxLatency;
+
+static void log_pm_lock_stats(const char* reason) {
+  for (const PmLock* lock : {&gTxCpuLock, &gTxApbLock, &gTxBusyLock}) {
+    const PmLockStats stats = lock->stats();
+    ESP_LOGI(kTag, "%s: lock %s holds=%lu total=%llums avg=%luus last=%luus max=%luus", reason, lock->name(),
+             static_cast<unsigned long>(stats.acquisitions),
+             static_cast<unsigned long long>(stats.heldUs / 1000ULL),
+             static_cast<unsigned long>(stats.acquisitions == 0 ? 0 : stats.heldUs / stats.acquisitions),
+             static_cast<unsigned long>(stats.lastHeldUs), static_cast<unsigned long>(stats.maxHeldUs));
+  }
+}
+
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+// Runs with interrupts off on the core entering/leaving sleep: counters only.
+static esp_err_t IRAM_ATTR on_light_sleep_exit(int64_t sleptUs, void*) {
+  const uint64_t us = sleptUs > 0 ? static_cast<uint64_t>(sleptUs) : 0;
+  const uint32_t seq = gLightSleepSeq.load(std::memory_order_relaxed);
+  gLightSleepSeq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  gLightSleep.sleeps++;
+  gLightSleep.sleptUs += us;
+  if (us > gLightSleep.longestUs) {
+    gLightSleep.longestUs = us;
+  }
+  gLightSleepSeq.store(seq + 2, std::memory_order_release);
+  return ESP_OK;
+}
+#endif
+
+static void register_light_sleep_callbacks() {
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+  static bool registered = false;
+  if (registered) {
+    return;
+  }
+  esp_pm_sleep_cbs_register_config_t cbs = {};
+  cbs.exit_cb = on_light_sleep_exit;
+  const esp_err_t err = esp_pm_light_sleep_register_cbs(&cbs);
+  if (err != ESP_OK) {
+    ESP_LOGW(kTag, "esp_pm_light_sleep_register_cbs failed: 0x%x", err);
+    return;
+  }
+  registered = true;
+#endif
+}
+
 static void configure_power_management() {
 #if CONFIG_PM_ENABLE
   gPmConfigureAttempted = true;
   esp_pm_config_t pm = {};
   pm.max_freq_mhz = kPmMaxFreqMhz;
   pm.min_freq_mhz = kPmMinFreqMhz;
-  // Light sleep currently causes NimBLE host to become disabled on this target build.
-  // Keep DFS enabled for savings while preserving BLE availability.
-  pm.light_sleep_enable = kPmLightSleepEnable;
+  // Without a BLE low-power clock that runs through sleep, the controller
+  // loses its connection timing and the host stops; see kPmLightSleepSupported.
+  pm.light_sleep_enable = gPmLightSleep && kPmLightSleepSupported;
   const esp_err_t err = esp_pm_configure(&pm);
   gPmConfigureErr = err;
   if (err == ESP_OK) {
     gPmConfigured = true;
+    register_light_sleep_callbacks();
     ESP_LOGI(kTag, "Power management configured (%d-%dMHz, light sleep %s)",
-             kPmMinFreqMhz, kPmMaxFreqMhz, kPmLightSleepEnable ? "on" : "off");
+             kPmMinFreqMhz, kPmMaxFreqMhz, pm.light_sleep_enable ? "on" : "off");
   } else {
     gPmConfigured = false;
     ESP_LOGE(kTag, "esp_pm_configure failed: 0x%x", err);
@@ -644,107 +2119,437 @@ static void log_pm_status() {
   } else {
     ESP_LOGW(kTag, "pm: enabled but config unavailable (err=0x%x)", err);
   }
+  log_pm_lock_stats("pm");
 #else
   ESP_LOGI(kTag, "pm: disabled in sdkconfig");
 #endif
 }
 
+// Idle cost against responsiveness: share of uptime spent in light sleep next
+// to how long queued pages waited for the air. Current draw itself has to be
+// measured externally; this gives the duty cycle to pair it with.
+static void log_power_profile(const char* reason) {
+  const uint64_t uptimeUs = static_cast<uint64_t>(esp_timer_get_time()) - gMetrics.read().bootUs;
+  const LightSleepCounters sleep = read_light_sleep();
+  const uint32_t sleepPm = permille(sleep.sleptUs, uptimeUs);
+  const PmLockStats busy = gTxBusyLock.stats();
+  const uint32_t busyPm = permille(busy.heldUs, uptimeUs);
+  ESP_LOGI(kTag, "%s: power light_sleep=%s%s asleep=%lu.%lu%% sleeps=%lu avg=%lums longest=%lums tx_busy=%lu.%lu%%",
+           reason, gPmLightSleep && kPmLightSleepSupported ? "on" : "off",
+           kPmLightSleepSupported ? "" : "(unsupported by sdkconfig)", static_cast<unsigned long>(sleepPm / 10),
+           static_cast<unsigned long>(sleepPm % 10), static_cast<unsigned long>(sleep.sleeps),
+           static_cast<unsigned long>(sleep.sleeps == 0 ? 0 : sleep.sleptUs / sleep.sleeps / 1000ULL),
+           static_cast<unsigned long>(sleep.longestUs / 1000ULL),
+           static_cast<unsigned long>(busyPm / 10), static_cast<unsigned long>(busyPm % 10));
+  const TxLatencyMetrics latency = gTxLatency.read();
+  ESP_LOGI(kTag, "%s: power queue_to_air n=%lu avg=%lums last=%lums max=%lums", reason,
+           static_cast<unsigned long>(latency.samples),
+           static_cast<unsigned long>(latency.samples == 0 ? 0 : latency.totalUs / latency.samples / 1000),
+           static_cast<unsigned long>(latency.lastUs / 1000), static_cast<unsigned long>(latency.maxUs / 1000));
+}
+
+static void set_light_sleep(bool enabled) {
+  gPmLightSleep = enabled;
+  if (enabled && !kPmLightSleepSupported) {
+    ESP_LOGW(kTag, "sleep: light sleep needs BLE modem sleep with a sleep clock (see sdkconfig.defaults)");
+  }
+  if (gPmConfigureAttempted) {
+    configure_power_management();
+  }
+}
+
+// Connection and advertising state change from the NimBLE host task, the
+// connection idle timer and command tasks (`ble restart`); the mutex orders
+// those writers, readers only go through the seqlock.
+template <typename T, typename Fn>
+static void link_metrics_write(Seqlock<T>& metrics, Fn&& fn) {
+  if (gLinkMetricsLock != nullptr) {
+    xSemaphoreTake(gLinkMetricsLock, portMAX_DELAY);
+  }
+  metrics.write(fn);
+  if (gLinkMetricsLock != nullptr) {
+    xSemaphoreGive(gLinkMetricsLock);
+  }
+}
+
 static void metrics_set_connected(bool connected) {
   const uint64_t now = static_cast<uint64_t>(esp_timer_get_time());
-  portENTER_CRITICAL(&gMetricsMux);
-  if (gMetrics.connected != connected) {
-    if (gMetrics.connected) {
-      gMetrics.connectedUs += now - gMetrics.connStateSinceUs;
+  bool changed = false;
+  link_metrics_write(gMetrics, [&](RuntimeMetrics& m) {
+    if (m.connected == connected) {
+      return;
+    }
+    if (m.connected) {
+      m.connectedUs += now - m.connStateSinceUs;
     } else {
-      gMetrics.disconnectedUs += now - gMetrics.connStateSinceUs;
+      m.disconnectedUs += now - m.connStateSinceUs;
     }
-    gMetrics.connected = connected;
-    gMetrics.connStateSinceUs = now;
+    m.connected = connected;
+    m.connStateSinceUs = now;
+    changed = true;
+  });
+  if (changed) {
+    (connected ? gTxCounters.connects : gTxCounters.disconnects).fetch_add(1, std::memory_order_relaxed);
   }
-  portEXIT_CRITICAL(&gMetricsMux);
 }
 
 static void metrics_set_advertising(bool advertising) {
   const uint64_t now = static_cast<uint64_t>(esp_timer_get_time());
+  const size_t tier = static_cast<size_t>(gAdvProfile);
   bool connectedWhileAdvertising = false;
-  portENTER_CRITICAL(&gMetricsMux);
-  connectedWhileAdvertising = advertising && gMetrics.connected;
-  if (gMetrics.advertising != advertising) {
-    if (gMetrics.advertising) {
-      gMetrics.advertisingUs += now - gMetrics.advStateSinceUs;
+  link_metrics_write(gMetrics, [&](RuntimeMetrics& m) {
+    connectedWhileAdvertising = advertising && m.connected;
+    if (m.advertising == advertising) {
+      return;
     }
-    gMetrics.advertising = advertising;
-    gMetrics.advStateSinceUs = now;
-  }
-  portEXIT_CRITICAL(&gMetricsMux);
+    if (m.advertising) {
+      m.advertisingUs += now - m.advStateSinceUs;
+      m.advTierUs[tier] += now - m.advStateSinceUs;
+    }
+    m.advertising = advertising;
+    m.advStateSinceUs = now;
+  });
   if (connectedWhileAdvertising) {
     ESP_LOGW(kTag, "metrics: invariant breach attempt (advertising while connected)");
   }
 }
 
+static void metrics_record_tx_lead(bool warm, uint32_t leadUs) {
+  gTxLeadMetrics.write([warm, leadUs](TxLeadMetrics& lead) {
+    if (warm) {
+      lead.warmStarts++;
+      lead.warmLeadUs += leadUs;
+    } else {
+      lead.coldStarts++;
+      lead.coldLeadUs += leadUs;
+    }
+    lead.lastLeadUs = leadUs;
+    if (leadUs > lead.maxLeadUs) {
+      lead.maxLeadUs = leadUs;
+    }
+  });
+}
+
+// The last frame that went on air: who it addressed and at what rate.
+struct HeardFrame {
+  uint32_t baud = 0;
+  std::array<uint32_t, kMaxPackedPages> capcodes = {};
+  size_t capcodeCount = 0;
+};
+
+static void record_heard_frame(const PocsagFrame& frame, const std::vector<TxJob*>& jobs, HeardFrame* heard) {
+  heard->baud = frame.baud;
+  heard->capcodeCount = 0;
+  for (const TxJob* job : jobs) {
+    if (heard->capcodeCount < heard->capcodes.size()) {
+      heard->capcodes[heard->capcodeCount++] = job->capcode;
+    }
+  }
+}
+
+// A pager that has just received a transmission is not deep in its battery-save
+// cycle yet, so a page following one closely (or queued behind the frame on
+// air, which it follows back to back) can go out with the short preamble. Only
+// pagers that were addressed by that frame, at the same baud, are known to be
+// awake and synced; anything else gets the full preamble.
+static uint32_t select_preamble_bits(const Config& cfg, const HeardFrame& heard, bool followsFrameOnAir,
+                                     int64_t lastDoneUs, const std::vector<TxJob*>& jobs, uint32_t baud) {
+  if (cfg.shortPreambleWindowMs == 0 || cfg.shortPreambleBits >= cfg.preambleBits) {
+    return cfg.preambleBits;
+  }
+  if (heard.capcodeCount == 0 || baud != heard.baud) {
+    return cfg.preambleBits;
+  }
+  const uint32_t* heardEnd = heard.capcodes.data() + heard.capcodeCount;
+  for (const TxJob* job : jobs) {
+    if (std::find(heard.capcodes.data(), heardEnd, job->capcode) == heardEnd) {
+      return cfg.preambleBits;
+    }
+  }
+  if (followsFrameOnAir) {
+    return cfg.shortPreambleBits;
+  }
+  const int64_t sinceUs = esp_timer_get_time() - lastDoneUs;
+  const bool recent = lastDoneUs > 0 && sinceUs <= static_cast<int64_t>(cfg.shortPreambleWindowMs) * 1000;
+  return recent ? cfg.shortPreambleBits : cfg.preambleBits;
+}
+
+static void metrics_record_preamble(const Config& cfg, const PocsagFrame& frame, int64_t gapUs) {
+  const uint32_t savedBits = frame.preambleBits < cfg.preambleBits ? cfg.preambleBits - frame.preambleBits : 0;
+  const uint32_t baud = frame.baud != 0 ? frame.baud : cfg.baud;
+  gPreambleMetrics.write([savedBits, baud, gapUs](PreambleMetrics& preamble) {
+    if (savedBits == 0) {
+      preamble.fullFrames++;
+      return;
+    }
+    preamble.shortFrames++;
+    preamble.savedBits += savedBits;
+    preamble.savedUs += static_cast<uint64_t>(savedBits) * 1000000ULL / baud;
+    preamble.lastGapMs = gapUs > 0 ? static_cast<uint32_t>(gapUs / 1000) : 0;
+  });
+}
+
+static void metrics_record_encode(uint32_t encodeUs) {
+  gTxCounters.encodeUsLast.store(encodeUs, std::memory_order_relaxed);
+  uint32_t seen = gTxCounters.encodeUsMax.load(std::memory_order_relaxed);
+  while (encodeUs > seen &&
+         !gTxCounters.encodeUsMax.compare_exchange_weak(seen, encodeUs, std::memory_order_relaxed)) {
+  }
+}
+
+// Smallest bucket edge covering pct percent of the recorded reconnects; the
+// open bucket maps to kAdvScheduleMaxMs.
+static uint32_t reconnect_percentile_ms(const AdvSchedulerMetrics& sched, uint32_t pct) {
+  const uint64_t target = (static_cast<uint64_t>(sched.reconnects) * pct + 99) / 100;
+  uint64_t seen = 0;
+  for (size_t i = 0; i + 1 < kReconnectBuckets; ++i) {
+    seen += sched.reconnectHist[i];
+    if (seen >= target) {
+      return kReconnectBucketEdgesMs[i];
+    }
+  }
+  return kAdvScheduleMaxMs;
+}
+
+// Lays the tiers out so the fast tier covers the median reconnect, medium the
+// 80th and relaxed the 95th percentile; each tier runs at least kAdvMinTierMs.
+// Until kAdvLearnMinSamples reconnects are seen the default windows apply.
+static void adv_schedule_update(AdvSchedulerMetrics& sched) {
+  if (sched.reconnects < kAdvLearnMinSamples) {
+    return;
+  }
+  static constexpr uint32_t kTierPercentiles[] = {50, 80, 95};
+  uint32_t previousEndMs = 0;
+  for (size_t tier = 0; tier < kAdvProfileCount - 1; ++tier) {
+    uint32_t endMs = reconnect_percentile_ms(sched, kTierPercentiles[tier]);
+    if (endMs < previousEndMs + kAdvMinTierMs) {
+      endMs = previousEndMs + kAdvMinTierMs;
+    }
+    if (endMs > kAdvScheduleMaxMs) {
+      endMs = kAdvScheduleMaxMs > previousEndMs + kAdvMinTierMs ? kAdvScheduleMaxMs : previousEndMs + kAdvMinTierMs;
+    }
+    sched.windowMs[tier] = static_cast<int32_t>(endMs - previousEndMs);
+    previousEndMs = endMs;
+  }
+  sched.learned = true;
+}
+
+static void adv_record_reconnect(uint32_t delayMs, AdvProfile tier) {
+  size_t bucket = 0;
+  while (bucket + 1 < kReconnectBuckets && delayMs >= kReconnectBucketEdgesMs[bucket]) {
+    bucket++;
+  }
+  gAdvSched.write([&](AdvSchedulerMetrics& sched) {
+    sched.reconnectHist[bucket]++;
+    sched.reconnects++;
+    sched.reconnectTotalMs += delayMs;
+    sched.lastReconnectMs = delayMs;
+    sched.connectsByTier[static_cast<size_t>(tier)]++;
+    adv_schedule_update(sched);
+  });
+}
+
+static int32_t adv_window_ms(AdvProfile profile) {
+  if (profile == AdvProfile::kSlowIdle) {
+    return BLE_HS_FOREVER;
+  }
+  const AdvSchedulerMetrics sched = gAdvSched.read();
+  return sched.learned ? sched.windowMs[static_cast<size_t>(profile)] : get_adv_profile_config(profile).durationMs;
+}
+
+static void log_adv_scheduler(const char* reason) {
+  const uint64_t now = static_cast<uint64_t>(esp_timer_get_time());
+  AdvSchedulerMetrics sched = gAdvSched.read();
+  const RuntimeMetrics link = gMetrics.read();
+  uint64_t tierUs[kAdvProfileCount] = {};
+  for (size_t tier = 0; tier < kAdvProfileCount; ++tier) {
+    tierUs[tier] = link.advTierUs[tier];
+  }
+  if (link.advertising) {
+    tierUs[static_cast<size_t>(gAdvProfile)] += now - link.advStateSinceUs;
+  }
+
+  if (!sched.learned) {
+    for (size_t tier = 0; tier < kAdvProfileCount - 1; ++tier) {
+      sched.windowMs[tier] = get_adv_profile_config(static_cast<AdvProfile>(tier)).durationMs;
+    }
+  }
+  ESP_LOGI(kTag, "%s: adv_sched %s windows fast=%lds medium=%lds relaxed=%lds then slow",
+           reason, sched.learned ? "learned" : "default",
+           static_cast<long>(sched.windowMs[0] / 1000), static_cast<long>(sched.windowMs[1] / 1000),
+           static_cast<long>(sched.windowMs[2] / 1000));
+  // Advertising events are estimated from the time spent in each tier and its mean interval.
+  for (size_t tier = 0; tier < kAdvProfileCount; ++tier) {
+    const AdvProfileConfig cfg = get_adv_profile_config(static_cast<AdvProfile>(tier));
+    const uint64_t meanIntervalUs = (static_cast<uint64_t>(cfg.intervalMin) + cfg.intervalMax) * 625ULL / 2ULL;
+    ESP_LOGI(kTag, "%s: adv_tier %s time=%llus events~%llu connects=%lu", reason, cfg.label,
+             static_cast<unsigned long long>(tierUs[tier] / 1000000ULL),
+             static_cast<unsigned long long>(meanIntervalUs == 0 ? 0 : tierUs[tier] / meanIntervalUs),
+             static_cast<unsigned long>(sched.connectsByTier[tier]));
+  }
+  char hist[160] = {};
+  size_t used = 0;
+  for (size_t i = 0; i < kReconnectBuckets && used < sizeof(hist); ++i) {
+    const int written =
+        i + 1 < kReconnectBuckets
+            ? std::snprintf(hist + used, sizeof(hist) - used, " <%lus:%lu",
+                            static_cast<unsigned long>(kReconnectBucketEdgesMs[i] / 1000),
+                            static_cast<unsigned long>(sched.reconnectHist[i]))
+            : std::snprintf(hist + used, sizeof(hist) - used, " >=%lus:%lu",
+                            static_cast<unsigned long>(kReconnectBucketEdgesMs[i - 1] / 1000),
+                            static_cast<unsigned long>(sched.reconnectHist[i]));
+    if (written < 0) {
+      break;
+    }
+    used += static_cast<size_t>(written);
+  }
+  const unsigned long avgMs =
+      sched.reconnects == 0 ? 0 : static_cast<unsigned long>(sched.reconnectTotalMs / sched.reconnects);
+  ESP_LOGI(kTag, "%s: reconnect n=%lu avg=%lums last=%lums hist:%s", reason,
+           static_cast<unsigned long>(sched.reconnects), avgMs, static_cast<unsigned long>(sched.lastReconnectMs),
+           hist);
+}
+
+static void build_metrics_record(pager_proto::MetricsRecord* out) {
+  const uint64_t now = static_cast<uint64_t>(esp_timer_get_time());
+  const RuntimeMetrics link = gMetrics.read();
+  const TaskCpuSnapshot tasks = gTaskCpu.read();
+  *out = {};
+  out->uptimeS = static_cast<uint32_t>((now - link.bootUs) / 1000000ULL);
+  out->flags = (link.connected ? pager_proto::kMetricsFlagConnected : 0) |
+               (link.advertising ? pager_proto::kMetricsFlagAdvertising : 0);
+  const size_t depth = gTxScheduler.depth();
+  out->queueDepth = static_cast<uint8_t>(depth > 0xFF ? 0xFF : depth);
+  const uint32_t highWater = gTxScheduler.depth_high_water();
+  out->queueHighWater = static_cast<uint8_t>(highWater > 0xFF ? 0xFF : highWater);
+  out->cpuMhz = static_cast<uint16_t>(esp_clk_cpu_freq() / 1000000);
+  out->connectedS =
+      static_cast<uint32_t>((link.connectedUs + (link.connected ? now - link.connStateSinceUs : 0)) / 1000000ULL);
+  out->advertisingS =
+      static_cast<uint32_t>((link.advertisingUs + (link.advertising ? now - link.advStateSinceUs : 0)) / 1000000ULL);
+  out->connects = gTxCounters.connects.load(std::memory_order_relaxed);
+  out->disconnects = gTxCounters.disconnects.load(std::memory_order_relaxed);
+  out->queued = gTxCounters.queued.load(std::memory_order_relaxed);
+  out->sent = gTxCounters.sent.load(std::memory_order_relaxed);
+  out->failed = gTxCounters.failed.load(std::memory_order_relaxed);
+  out->dropped = gTxCounters.dropped.load(std::memory_order_relaxed);
+  out->coalesced = gTxCounters.coalesced.load(std::memory_order_relaxed);
+  out->encodeUsLast = gTxCounters.encodeUsLast.load(std::memory_order_relaxed);
+  out->encodeUsMax = gTxCounters.encodeUsMax.load(std::memory_order_relaxed);
+  out->airtimeMs = gTxCounters.airtimeMs.load(std::memory_order_relaxed);
+  out->taskCount = tasks.valid ? tasks.count : 0;
+  for (uint8_t i = 0; i < out->taskCount; ++i) {
+    out->tasks[i] = tasks.tasks[i];
+  }
+}
+
+static void log_metrics_record() {
+  pager_proto::MetricsRecord record;
+  build_metrics_record(&record);
+  uint8_t bytes[pager_proto::kMetricsMaxBytes];
+  const size_t length = pager_proto::write_metrics_record(record, bytes);
+  char hex[pager_proto::kMetricsMaxBytes * 2 + 1];
+  for (size_t i = 0; i < length; ++i) {
+    std::snprintf(hex + i * 2, 3, "%02x", bytes[i]);
+  }
+  hex[length * 2] = '\0';
+  ESP_LOGI(kTag, "metrics bin %u %s", static_cast<unsigned>(length), hex);
+}
+
+// Percentages are printed from integer permille so logging needs no float
+// formatting.
 static void log_runtime_metrics(const char* reason) {
   const uint64_t now = static_cast<uint64_t>(esp_timer_get_time());
-  uint64_t uptimeUs = 0;
-  uint64_t connectedUs = 0;
-  uint64_t disconnectedUs = 0;
-  uint64_t advertisingUs = 0;
-  CpuMetrics cpu = {};
-  portENTER_CRITICAL(&gMetricsMux);
-  uptimeUs = now - gMetrics.bootUs;
-  connectedUs = gMetrics.connectedUs + (gMetrics.connected ? (now - gMetrics.connStateSinceUs) : 0);
-  disconnectedUs = gMetrics.disconnectedUs + (gMetrics.connected ? 0 : (now - gMetrics.connStateSinceUs));
-  advertisingUs = gMetrics.advertisingUs + (gMetrics.advertising ? (now - gMetrics.advStateSinceUs) : 0);
-  cpu = gCpuMetrics;
-  portEXIT_CRITICAL(&gMetricsMux);
-
-  const float connectedPct = uptimeUs == 0 ? 0.0f : (100.0f * static_cast<float>(connectedUs) / static_cast<float>(uptimeUs));
-  const float disconnectedPct =
-      uptimeUs == 0 ? 0.0f : (100.0f * static_cast<float>(disconnectedUs) / static_cast<float>(uptimeUs));
-  const float advertisingPct =
-      uptimeUs == 0 ? 0.0f : (100.0f * static_cast<float>(advertisingUs) / static_cast<float>(uptimeUs));
-
-  ESP_LOGI(kTag, "metrics[%s]: up=%llus conn=%llus(%.1f%%) disc=%llus(%.1f%%) adv=%llus(%.1f%%)",
+  const RuntimeMetrics link = gMetrics.read();
+  const CpuMetrics cpu = gCpuMetrics.read();
+  const TxLeadMetrics lead = gTxLeadMetrics.read();
+  const uint64_t uptimeUs = now - link.bootUs;
+  const uint64_t connectedUs = link.connectedUs + (link.connected ? (now - link.connStateSinceUs) : 0);
+  const uint64_t disconnectedUs = link.disconnectedUs + (link.connected ? 0 : (now - link.connStateSinceUs));
+  const uint64_t advertisingUs = link.advertisingUs + (link.advertising ? (now - link.advStateSinceUs) : 0);
+
+  const uint32_t connectedPm = permille(connectedUs, uptimeUs);
+  const uint32_t disconnectedPm = permille(disconnectedUs, uptimeUs);
+  const uint32_t advertisingPm = permille(advertisingUs, uptimeUs);
+  ESP_LOGI(kTag, "metrics[%s]: up=%llus conn=%llus(%lu.%lu%%) disc=%llus(%lu.%lu%%) adv=%llus(%lu.%lu%%)",
            reason,
            static_cast<unsigned long long>(uptimeUs / 1000000ULL),
-           static_cast<unsigned long long>(connectedUs / 1000000ULL), connectedPct,
-           static_cast<unsigned long long>(disconnectedUs / 1000000ULL), disconnectedPct,
-           static_cast<unsigned long long>(advertisingUs / 1000000ULL), advertisingPct);
+           static_cast<unsigned long long>(connectedUs / 1000000ULL),
+           static_cast<unsigned long>(connectedPm / 10), static_cast<unsigned long>(connectedPm % 10),
+           static_cast<unsigned long long>(disconnectedUs / 1000000ULL),
+           static_cast<unsigned long>(disconnectedPm / 10), static_cast<unsigned long>(disconnectedPm % 10),
+           static_cast<unsigned long long>(advertisingUs / 1000000ULL),
+           static_cast<unsigned long>(advertisingPm / 10), static_cast<unsigned long>(advertisingPm % 10));
 
   const int currentMhz = esp_clk_cpu_freq() / 1000000;
-  const float pct40 = cpu.samples == 0 ? 0.0f : (100.0f * static_cast<float>(cpu.mhz40) / static_cast<float>(cpu.samples));
-  const float pct80 = cpu.samples == 0 ? 0.0f : (100.0f * static_cast<float>(cpu.mhz80) / static_cast<float>(cpu.samples));
-  const float pct160 =
-      cpu.samples == 0 ? 0.0f : (100.0f * static_cast<float>(cpu.mhz160) / static_cast<float>(cpu.samples));
-  const float pct240 =
-      cpu.samples == 0 ? 0.0f : (100.0f * static_cast<float>(cpu.mhz240) / static_cast<float>(cpu.samples));
-  const float pctOther =
-      cpu.samples == 0 ? 0.0f : (100.0f * static_cast<float>(cpu.mhzOther) / static_cast<float>(cpu.samples));
-  ESP_LOGI(kTag, "metrics[%s]: cpu_freq now=%dMHz samples=%llu [40:%.1f%% 80:%.1f%% 160:%.1f%% 240:%.1f%% other:%.1f%%]",
-           reason, currentMhz, static_cast<unsigned long long>(cpu.samples), pct40, pct80, pct160, pct240, pctOther);
+  const uint32_t pm40 = permille(cpu.mhz40, cpu.samples);
+  const uint32_t pm80 = permille(cpu.mhz80, cpu.samples);
+  const uint32_t pm160 = permille(cpu.mhz160, cpu.samples);
+  const uint32_t pm240 = permille(cpu.mhz240, cpu.samples);
+  const uint32_t pmOther = permille(cpu.mhzOther, cpu.samples);
+  ESP_LOGI(kTag,
+           "metrics[%s]: cpu_freq now=%dMHz samples=%llu [40:%lu.%lu%% 80:%lu.%lu%% 160:%lu.%lu%% 240:%lu.%lu%% "
+           "other:%lu.%lu%%]",
+           reason, currentMhz, static_cast<unsigned long long>(cpu.samples),
+           static_cast<unsigned long>(pm40 / 10), static_cast<unsigned long>(pm40 % 10),
+           static_cast<unsigned long>(pm80 / 10), static_cast<unsigned long>(pm80 % 10),
+           static_cast<unsigned long>(pm160 / 10), static_cast<unsigned long>(pm160 % 10),
+           static_cast<unsigned long>(pm240 / 10), static_cast<unsigned long>(pm240 % 10),
+           static_cast<unsigned long>(pmOther / 10), static_cast<unsigned long>(pmOther % 10));
+
+  const unsigned long long coldAvgUs = lead.coldStarts == 0 ? 0 : lead.coldLeadUs / lead.coldStarts;
+  const unsigned long long warmAvgUs = lead.warmStarts == 0 ? 0 : lead.warmLeadUs / lead.warmStarts;
+  ESP_LOGI(kTag, "metrics[%s]: tx_lead cold=%lluus(n=%llu) warm=%lluus(n=%llu) last=%luus max=%luus",
+           reason, coldAvgUs, static_cast<unsigned long long>(lead.coldStarts),
+           warmAvgUs, static_cast<unsigned long long>(lead.warmStarts),
+           static_cast<unsigned long>(lead.lastLeadUs), static_cast<unsigned long>(lead.maxLeadUs));
+
+  pager_proto::MetricsRecord record;
+  build_metrics_record(&record);
+  ESP_LOGI(kTag,
+           "metrics[%s]: tx queued=%lu sent=%lu failed=%lu dropped=%lu coalesced=%lu depth=%u encode=%luus(max=%luus) "
+           "air=%lums connects=%lu",
+           reason, static_cast<unsigned long>(record.queued), static_cast<unsigned long>(record.sent),
+           static_cast<unsigned long>(record.failed), static_cast<unsigned long>(record.dropped),
+           static_cast<unsigned long>(record.coalesced), static_cast<unsigned>(record.queueDepth),
+           static_cast<unsigned long>(record.encodeUsLast), static_cast<unsigned long>(record.encodeUsMax),
+           static_cast<unsigned long>(record.airtimeMs), static_cast<unsigned long>(record.connects));
+  const PreambleMetrics preamble = gPreambleMetrics.read();
+  ESP_LOGI(kTag, "metrics[%s]: preamble full=%lu short=%lu saved=%llubits/%llums last_gap=%lums", reason,
+           static_cast<unsigned long>(preamble.fullFrames), static_cast<unsigned long>(preamble.shortFrames),
+           static_cast<unsigned long long>(preamble.savedBits),
+           static_cast<unsigned long long>(preamble.savedUs / 1000), static_cast<unsigned long>(preamble.lastGapMs));
+
+  char schedReason[32];
+  std::snprintf(schedReason, sizeof(schedReason), "metrics[%s]", reason);
+  log_pm_lock_stats(schedReason);
+  log_power_profile(schedReason);
+  log_adv_scheduler(schedReason);
 
 #if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS && CONFIG_FREERTOS_USE_TRACE_FACILITY
-  const UBaseType_t taskCount = uxTaskGetNumberOfTasks();
-  std::vector<TaskStatus_t> taskStats(taskCount + 4);
-  uint32_t totalRuntime = 0;
-  const UBaseType_t populated = uxTaskGetSystemState(taskStats.data(), taskStats.size(), &totalRuntime);
-  if (populated > 0 && totalRuntime > 0) {
-    uint64_t idleRuntime = 0;
-    for (UBaseType_t i = 0; i < populated; ++i) {
-      if (std::strncmp(taskStats[i].pcTaskName, "IDLE", 4) == 0) {
-        idleRuntime += taskStats[i].ulRunTimeCounter;
-      }
+  const TaskCpuSnapshot tasks = gTaskCpu.read();
+  if (!tasks.valid) {
+    ESP_LOGW(kTag, "metrics[%s]: cpu_load unavailable (no task snapshot yet)", reason);
+    return;
+  }
+  const uint32_t idlePm = 1000U - tasks.busyPermille;
+  ESP_LOGI(kTag, "metrics[%s]: cpu_load busy=%u.%u%% idle=%lu.%lu%% cores=%u (task stats)", reason,
+           static_cast<unsigned>(tasks.busyPermille / 10), static_cast<unsigned>(tasks.busyPermille % 10),
+           static_cast<unsigned long>(idlePm / 10), static_cast<unsigned long>(idlePm % 10),
+           static_cast<unsigned>(portNUM_PROCESSORS));
+  char line[160] = {};
+  size_t used = 0;
+  for (uint8_t i = 0; i < tasks.count; ++i) {
+    const int written = std::snprintf(line + used, sizeof(line) - used, " %.*s:%u.%u%%",
+                                      static_cast<int>(pager_proto::kMetricsTaskNameBytes), tasks.tasks[i].name,
+                                      static_cast<unsigned>(tasks.tasks[i].cpuPermille / 10),
+                                      static_cast<unsigned>(tasks.tasks[i].cpuPermille % 10));
+    if (written < 0 || used + static_cast<size_t>(written) >= sizeof(line)) {
+      break;
     }
-    const uint32_t cores = static_cast<uint32_t>(portNUM_PROCESSORS);
-    const float capacity = static_cast<float>(totalRuntime) * static_cast<float>(cores);
-    float idlePct = capacity > 0.0f ? (100.0f * static_cast<float>(idleRuntime) / capacity) : 0.0f;
-    if (idlePct < 0.0f) idlePct = 0.0f;
-    if (idlePct > 100.0f) idlePct = 100.0f;
-    const float busyPct = 100.0f - idlePct;
-    ESP_LOGI(kTag, "metrics[%s]: cpu_load busy=%.1f%% idle=%.1f%% cores=%u (task stats)",
-             reason, busyPct, idlePct, static_cast<unsigned>(cores));
-  } else {
-    ESP_LOGW(kTag, "metrics[%s]: cpu_load unavailable (task snapshot empty)", reason);
+    used += static_cast<size_t>(written);
   }
+  ESP_LOGI(kTag, "metrics[%s]: tasks%s", reason, line);
 #else
   ESP_LOGI(kTag, "metrics[%s]: cpu_load unavailable (enable FREERTOS run-time stats)", reason);
 #endif
@@ -758,11 +2563,13 @@ static void pm_arm_task(void*) {
 
 static void metrics_task(void*) {
   uint32_t elapsedMs = 0;
+  task_cpu_sample();
   while (true) {
     vTaskDelay(pdMS_TO_TICKS(kCpuSamplePeriodMs));
     cpu_metrics_sample();
     elapsedMs += kCpuSamplePeriodMs;
     if (elapsedMs >= kMetricsLogPeriodMs) {
+      task_cpu_sample();
       log_runtime_metrics("periodic");
       elapsedMs = 0;
     }
@@ -775,11 +2582,15 @@ static void log_ble_status() {
   const esp_power_level_t defaultLevel = esp_ble_tx_power_get(ESP_BLE_PWR_TYPE_DEFAULT);
   ESP_LOGI(kTag, "ble: name=%s connected=%s advertising=%s interval=%.2f-%.2f s",
            kBleDeviceName,
-           gBleConnHandle == BLE_HS_CONN_HANDLE_NONE ? "no" : "yes",
+           gBleConnHandle.load(std::memory_order_acquire) == BLE_HS_CONN_HANDLE_NONE ? "no" : "yes",
            gBleAdvertising ? "yes" : "no",
            advCfg.intervalMin * 0.000625f, advCfg.intervalMax * 0.000625f);
-  ESP_LOGI(kTag, "ble: profile=%s duration=%s",
-           advCfg.label, advCfg.durationMs == BLE_HS_FOREVER ? "forever" : "15s");
+  const int32_t advWindowMs = adv_window_ms(gAdvProfile);
+  if (advWindowMs == BLE_HS_FOREVER) {
+    ESP_LOGI(kTag, "ble: profile=%s duration=forever", advCfg.label);
+  } else {
+    ESP_LOGI(kTag, "ble: profile=%s duration=%lds", advCfg.label, static_cast<long>(advWindowMs / 1000));
+  }
   ESP_LOGI(kTag, "ble: tx_power target=%ddBm adv=%ddBm default=%ddBm",
            ble_tx_power_dbm(gBleTxPowerTarget), ble_tx_power_dbm(advLevel), ble_tx_power_dbm(defaultLevel));
   if (gBleAddrValid) {
@@ -787,171 +2598,1160 @@ static void log_ble_status() {
              gBleAddr[5], gBleAddr[4], gBleAddr[3], gBleAddr[2], gBleAddr[1], gBleAddr[0]);
   }
   ESP_LOGI(kTag, "ble: service=%s", kServiceUuidStr);
-  ESP_LOGI(kTag, "ble: rx=%s status=%s", kRxUuidStr, kStatusUuidStr);
+  ESP_LOGI(kTag, "ble: rx=%s status=%s metrics=%s", kRxUuidStr, kStatusUuidStr, kMetricsUuidStr);
+  if (gBleConnHandle.load(std::memory_order_acquire) != BLE_HS_CONN_HANDLE_NONE) {
+    log_ble_link("current");
+  }
+  log_conn_profile("ble");
+  log_adv_scheduler("ble");
+  const BleIngestStats ingest = gBleIngest.stats();
+  ESP_LOGI(kTag, "ble: ingest depth=%lu/%u hwm=%lu pushed=%lu dropped=%lu oversize=%lu",
+           static_cast<unsigned long>(ingest.depth), static_cast<unsigned>(kBleIngestSlots),
+           static_cast<unsigned long>(ingest.highWater), static_cast<unsigned long>(ingest.pushed),
+           static_cast<unsigned long>(ingest.dropped), static_cast<unsigned long>(ingest.oversize));
+  if (kCountCxxAllocs) {
+    const BleRxAllocMetrics allocs = gBleRxAllocMetrics.read();
+    ESP_LOGI(kTag, "ble: rx heap allocs per write last=%lu max=%lu total=%lu writes=%lu",
+             static_cast<unsigned long>(allocs.lastWriteAllocs), static_cast<unsigned long>(allocs.maxWriteAllocs),
+             static_cast<unsigned long>(allocs.allocs), static_cast<unsigned long>(allocs.writes));
+  }
+  const BleBinaryMetrics binary = gBleBinaryMetrics.read();
+  ESP_LOGI(kTag, "ble: binary v%u frames=%lu pages=%lu bad_frames=%lu bad_records=%lu",
+           static_cast<unsigned>(pager_proto::kVersion), static_cast<unsigned long>(binary.frames),
+           static_cast<unsigned long>(binary.pages), static_cast<unsigned long>(binary.badFrames),
+           static_cast<unsigned long>(binary.badRecords));
+  ESP_LOGI(kTag, "ble: acks subscribed=%s notifies=%lu entries=%lu failed=%lu",
+           gBleStatusSubscribed.load(std::memory_order_acquire) ? "yes" : "no",
+           static_cast<unsigned long>(gBleAckCounters.notifies.load(std::memory_order_relaxed)),
+           static_cast<unsigned long>(gBleAckCounters.entries.load(std::memory_order_relaxed)),
+           static_cast<unsigned long>(gBleAckCounters.failed.load(std::memory_order_relaxed)));
+}
+
+// Runtime configuration. `set` changes one field of the live Config and writes
+// the whole struct to NVS as a ConfigBlob; the blob is read once at boot. A
+// blob with the wrong magic/version/size, a bad CRC or out-of-range fields is
+// ignored and the compiled-in defaults are used.
+constexpr char kNvsNamespace[] = "pager";
+constexpr char kNvsConfigKey[] = "config";
+constexpr uint32_t kConfigBlobMagic = 0x47464350;  // "PCFG"
+constexpr uint16_t kConfigBlobVersion = 2;         // bump when Config's layout changes
+
+struct ConfigBlob {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t size;  // sizeof(Config) when written
+  Config config;
+  uint32_t crc;   // esp_crc32_le over everything above
+};
+
+constexpr char kNvsProfilesKey[] = "profiles";
+constexpr uint32_t kProfilesBlobMagic = 0x46525050;  // "PPRF"
+constexpr uint16_t kProfilesBlobVersion = 1;         // bump when RecipientProfile's layout changes
+
+struct ProfilesBlob {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;
+  RecipientProfile profiles[kMaxProfiles];
+  uint32_t crc;  // esp_crc32_le over everything above
+};
+
+enum class ConfigFieldKind : uint8_t { kUint, kBool, kOutput, kDropPolicy };
+
+constexpr size_t kConfigTextMax = 24;  // longest key or value `set` accepts
+
+struct ConfigField {
+  std::string_view name;
+  ConfigFieldKind kind;
+  uint32_t min;
+  uint32_t max;
+  uint32_t (*get)(const Config& cfg);
+  void (*set)(Config& cfg, uint32_t value);
+};
+
+// Keep sorted by name; checked at compile time below.
+constexpr ConfigField kConfigFields[] = {
+    {"baud", ConfigFieldKind::kUint, kBaudMin, kBaudMax, [](const Config& c) { return c.baud; },
+     [](Config& c, uint32_t v) { c.baud = v; }},
+    {"capcode", ConfigFieldKind::kUint, 0, kCapcodeMax, [](const Config& c) { return c.capInd; },
+     [](Config& c, uint32_t v) { c.capInd = v; }},
+    {"coalesce_ms", ConfigFieldKind::kUint, 0, 600000, [](const Config& c) { return c.coalesceWindowMs; },
+     [](Config& c, uint32_t v) { c.coalesceWindowMs = v; }},
+    {"drive_one_low", ConfigFieldKind::kBool, 0, 1, [](const Config& c) { return uint32_t{c.driveOneLow}; },
+     [](Config& c, uint32_t v) { c.driveOneLow = v != 0; }},
+    {"drop_policy", ConfigFieldKind::kDropPolicy, 0, 1,
+     [](const Config& c) { return static_cast<uint32_t>(c.dropPolicy); },
+     [](Config& c, uint32_t v) { c.dropPolicy = static_cast<TxDropPolicy>(v); }},
+    {"function", ConfigFieldKind::kUint, 0, 3, [](const Config& c) { return uint32_t{c.functionBits}; },
+     [](Config& c, uint32_t v) { c.functionBits = static_cast<uint8_t>(v); }},
+    {"gpio", ConfigFieldKind::kUint, 1, 9, [](const Config& c) { return static_cast<uint32_t>(c.dataGpio); },
+     [](Config& c, uint32_t v) { c.dataGpio = static_cast<int>(v); }},
+    {"idle_high", ConfigFieldKind::kBool, 0, 1, [](const Config& c) { return uint32_t{c.idleHigh}; },
+     [](Config& c, uint32_t v) { c.idleHigh = v != 0; }},
+    {"invert", ConfigFieldKind::kBool, 0, 1, [](const Config& c) { return uint32_t{c.invertWords}; },
+     [](Config& c, uint32_t v) { c.invertWords = v != 0; }},
+    {"keep_rmt", ConfigFieldKind::kBool, 0, 1, [](const Config& c) { return uint32_t{c.keepRmtChannel}; },
+     [](Config& c, uint32_t v) { c.keepRmtChannel = v != 0; }},
+    {"max_batches", ConfigFieldKind::kUint, 1, kMaxBatchesLimit,
+     [](const Config& c) { return uint32_t{c.maxBatches}; },
+     [](Config& c, uint32_t v) { c.maxBatches = static_cast<uint8_t>(v); }},
+    {"output", ConfigFieldKind::kOutput, 0, 1, [](const Config& c) { return static_cast<uint32_t>(c.output); },
+     [](Config& c, uint32_t v) { c.output = static_cast<OutputMode>(v); }},
+    {"preamble", ConfigFieldKind::kUint, 32, kMaxPreambleBits, [](const Config& c) { return c.preambleBits; },
+     [](Config& c, uint32_t v) { c.preambleBits = v; }},
+    {"preamble_short", ConfigFieldKind::kUint, 32, kMaxPreambleBits,
+     [](const Config& c) { return c.shortPreambleBits; }, [](Config& c, uint32_t v) { c.shortPreambleBits = v; }},
+    {"preamble_window_ms", ConfigFieldKind::kUint, 0, 600000,
+     [](const Config& c) { return c.shortPreambleWindowMs; },
+     [](Config& c, uint32_t v) { c.shortPreambleWindowMs = v; }},
+    {"rmt_release_ms", ConfigFieldKind::kUint, 0, 3600000, [](const Config& c) { return c.rmtReleaseIdleMs; },
+     [](Config& c, uint32_t v) { c.rmtReleaseIdleMs = v; }},
+};
+constexpr size_t kConfigFieldCount = sizeof(kConfigFields) / sizeof(kConfigFields[0]);
+
+constexpr bool config_fields_sorted() {
+  for (size_t i = 1; i < kConfigFieldCount; ++i) {
+    if (!(kConfigFields[i - 1].name < kConfigFields[i].name) || kConfigFields[i].name.size() > kConfigTextMax) {
+      return false;
+    }
+  }
+  return true;
+}
+static_assert(config_fields_sorted(), "kConfigFields must be sorted by name, names at most kConfigTextMax chars");
+
+static const ConfigField* find_config_field(std::string_view name) {
+  const ConfigField* end = kConfigFields + kConfigFieldCount;
+  const ConfigField* it = std::lower_bound(kConfigFields, end, name,
+                                           [](const ConfigField& field, std::string_view key) {
+                                             return field.name < key;
+                                           });
+  return it != end && it->name == name ? it : nullptr;
+}
+
+// Every field in range and the data GPIO one of kDataGpioAllowed. The stored
+// config is driven at every boot, so a pin outside the list must never load.
+static bool config_valid(const Config& cfg) {
+  for (const ConfigField& field : kConfigFields) {
+    const uint32_t value = field.get(cfg);
+    if (value < field.min || value > field.max) {
+      return false;
+    }
+  }
+  return std::find(std::begin(kDataGpioAllowed), std::end(kDataGpioAllowed), cfg.dataGpio) !=
+         std::end(kDataGpioAllowed);
+}
+
+static const char* config_value_text(const ConfigField& field, uint32_t value, char* buf, size_t size) {
+  switch (field.kind) {
+    case ConfigFieldKind::kBool:
+      return value != 0 ? "on" : "off";
+    case ConfigFieldKind::kOutput:
+      return static_cast<OutputMode>(value) == OutputMode::kOpenDrain ? "open-drain" : "push-pull";
+    case ConfigFieldKind::kDropPolicy:
+      return static_cast<TxDropPolicy>(value) == TxDropPolicy::kReject ? "reject" : "drop-oldest";
+    case ConfigFieldKind::kUint:
+      break;
+  }
+  std::snprintf(buf, size, "%lu", static_cast<unsigned long>(value));
+  return buf;
+}
+
+static bool parse_config_value(const ConfigField& field, std::string_view text, uint32_t* out) {
+  switch (field.kind) {
+    case ConfigFieldKind::kBool:
+      if (text == "on" || text == "yes" || text == "true" || text == "1") {
+        *out = 1;
+        return true;
+      }
+      if (text == "off" || text == "no" || text == "false" || text == "0") {
+        *out = 0;
+        return true;
+      }
+      return false;
+    case ConfigFieldKind::kOutput:
+      if (text == "push-pull" || text == "open-drain") {
+        *out = static_cast<uint32_t>(text == "open-drain" ? OutputMode::kOpenDrain : OutputMode::kPushPull);
+        return true;
+      }
+      return false;
+    case ConfigFieldKind::kDropPolicy:
+      if (text == "drop-oldest" || text == "reject") {
+        *out = static_cast<uint32_t>(text == "reject" ? TxDropPolicy::kReject : TxDropPolicy::kDropOldest);
+        return true;
+      }
+      return false;
+    case ConfigFieldKind::kUint:
+      break;
+  }
+  const char* end = text.data() + text.size();
+  const std::from_chars_result result = std::from_chars(text.data(), end, *out);
+  return !text.empty() && result.ec == std::errc() && result.ptr == end && *out >= field.min && *out <= field.max;
+}
+
+static uint32_t config_blob_crc(const ConfigBlob& blob) {
+  return esp_crc32_le(0, reinterpret_cast<const uint8_t*>(&blob), offsetof(ConfigBlob, crc));
+}
+
+static bool init_nvs() {
+  esp_err_t err = nvs_flash_init();
+  if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+    ESP_ERROR_CHECK(nvs_flash_erase());
+    err = nvs_flash_init();
+  }
+  if (err != ESP_OK) {
+    ESP_LOGE(kTag, "nvs_flash_init failed: 0x%x", err);
+    return false;
+  }
+  return true;
+}
+
+// Reads exactly `size` bytes stored under `key`; ESP_ERR_NVS_NOT_FOUND when
+// nothing is stored and ESP_ERR_INVALID_SIZE when the stored blob differs.
+static esp_err_t nvs_load_blob(const char* key, void* out, size_t size) {
+  nvs_handle_t handle = 0;
+  esp_err_t err = nvs_open(kNvsNamespace, NVS_READONLY, &handle);
+  if (err != ESP_OK) {
+    return err;
+  }
+  size_t stored = size;
+  err = nvs_get_blob(handle, key, out, &stored);
+  nvs_close(handle);
+  if (err == ESP_OK && stored != size) {
+    err = ESP_ERR_INVALID_SIZE;
+  }
+  return err;
+}
+
+static esp_err_t nvs_store_blob(const char* key, const void* data, size_t size) {
+  nvs_handle_t handle = 0;
+  esp_err_t err = nvs_open(kNvsNamespace, NVS_READWRITE, &handle);
+  if (err != ESP_OK) {
+    return err;
+  }
+  err = nvs_set_blob(handle, key, data, size);
+  if (err == ESP_OK) {
+    err = nvs_commit(handle);
+  }
+  nvs_close(handle);
+  return err;
+}
+
+static esp_err_t nvs_erase_blob(const char* key) {
+  nvs_handle_t handle = 0;
+  esp_err_t err = nvs_open(kNvsNamespace, NVS_READWRITE, &handle);
+  if (err != ESP_OK) {
+    return err;
+  }
+  err = nvs_erase_key(handle, key);
+  if (err == ESP_ERR_NVS_NOT_FOUND) {
+    err = ESP_OK;
+  }
+  if (err == ESP_OK) {
+    err = nvs_commit(handle);
+  }
+  nvs_close(handle);
+  return err;
+}
+
+// Boot only, before any task reads the config.
+static void load_config() {
+  ConfigBlob blob = {};
+  const esp_err_t err = nvs_load_blob(kNvsConfigKey, &blob, sizeof(blob));
+  if (err == ESP_ERR_NVS_NOT_FOUND) {
+    ESP_LOGI(kTag, "config: no saved config, using defaults");
+    return;
+  }
+  if (err != ESP_OK || blob.magic != kConfigBlobMagic || blob.version != kConfigBlobVersion ||
+      blob.size != sizeof(Config) || blob.crc != config_blob_crc(blob) || !config_valid(blob.config)) {
+    ESP_LOGW(kTag, "config: saved config rejected (err=0x%x version=%u), using defaults", err,
+             static_cast<unsigned>(blob.version));
+    return;
+  }
+  gConfigStore.write([&blob](Config& cfg) { cfg = blob.config; });
+  ESP_LOGI(kTag, "config: loaded from NVS");
+}
+
+static esp_err_t save_config(const Config& cfg) {
+  ConfigBlob blob = {};
+  blob.magic = kConfigBlobMagic;
+  blob.version = kConfigBlobVersion;
+  blob.size = sizeof(Config);
+  blob.config = cfg;
+  blob.crc = config_blob_crc(blob);
+  return nvs_store_blob(kNvsConfigKey, &blob, sizeof(blob));
+}
+
+static esp_err_t erase_saved_config() { return nvs_erase_blob(kNvsConfigKey); }
+
+// Recipient profiles are stored the same way, as one blob holding the whole
+// table. A rejected blob leaves the table empty.
+static bool profile_valid(const RecipientProfile& profile) {
+  return profile.id[kProfileIdMax] == '\0' && valid_profile_id(profile.id) &&
+         profile.capcode <= kCapcodeMax && profile.functionBits <= 3 &&
+         (profile.baud == 0 || (profile.baud >= kBaudMin && profile.baud <= kBaudMax));
+}
+
+static uint32_t profiles_blob_crc(const ProfilesBlob& blob) {
+  return esp_crc32_le(0, reinterpret_cast<const uint8_t*>(&blob), offsetof(ProfilesBlob, crc));
+}
+
+// Boot only, before the command tasks start.
+static void load_profiles() {
+  ProfilesBlob blob = {};
+  const esp_err_t err = nvs_load_blob(kNvsProfilesKey, &blob, sizeof(blob));
+  if (err == ESP_ERR_NVS_NOT_FOUND) {
+    return;
+  }
+  bool valid = err == ESP_OK && blob.magic == kProfilesBlobMagic && blob.version == kProfilesBlobVersion &&
+               blob.count <= kMaxProfiles && blob.crc == profiles_blob_crc(blob);
+  for (size_t i = 0; valid && i < blob.count; ++i) {
+    valid = profile_valid(blob.profiles[i]);
+  }
+  if (!valid || !gProfiles.assign(blob.profiles, blob.count)) {
+    ESP_LOGW(kTag, "profiles: saved table rejected (err=0x%x version=%u)", err,
+             static_cast<unsigned>(blob.version));
+    return;
+  }
+  ESP_LOGI(kTag, "profiles: %u loaded from NVS", static_cast<unsigned>(blob.count));
+}
+
+// Caller holds gProfileLock.
+static esp_err_t save_profiles_locked() {
+  ProfilesBlob blob = {};
+  blob.magic = kProfilesBlobMagic;
+  blob.version = kProfilesBlobVersion;
+  blob.count = static_cast<uint16_t>(gProfiles.size());
+  for (size_t i = 0; i < gProfiles.size(); ++i) {
+    blob.profiles[i] = gProfiles.at(i);
+  }
+  blob.crc = profiles_blob_crc(blob);
+  return nvs_store_blob(kNvsProfilesKey, &blob, sizeof(blob));
+}
+
+// Publishes cfg and wakes the TX worker so it adopts it once it is between jobs.
+static void publish_config(const Config& cfg) {
+  gConfigStore.write([&cfg](Config& live) { live = cfg; });
+  gConfigVersion.fetch_add(1, std::memory_order_release);
+  if (gTxWorkerTask != nullptr) {
+    xTaskNotify(gTxWorkerTask, kTxNotifyConfig, eSetBits);
+  }
+}
+
+static void log_config_field(const ConfigField& field, const Config& cfg) {
+  char buf[12];
+  ESP_LOGI(kTag, "config: %.*s=%s", static_cast<int>(field.name.size()), field.name.data(),
+           config_value_text(field, field.get(cfg), buf, sizeof(buf)));
+}
+
+// Lowercased copy of `text` into `out`, the way dispatch_command folds
+// command names; false when it does not fit.
+template <size_t N>
+static bool fold_case(std::string_view text, char (&out)[N], std::string_view* folded) {
+  if (text.size() > N) {
+    return false;
+  }
+  for (size_t i = 0; i < text.size(); ++i) {
+    out[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(text[i])));
+  }
+  *folded = std::string_view(out, text.size());
+  return true;
+}
+
+// "set <key> <value>" or "set defaults", both case-insensitive. Returns false
+// on an unknown key or a value the field does not accept.
+static bool set_config(std::string_view line) {
+  const size_t split = line.find(' ');
+  std::string_view rawValue = split == std::string_view::npos ? std::string_view() : line.substr(split + 1);
+  while (!rawValue.empty() && rawValue.front() == ' ') {
+    rawValue.remove_prefix(1);
+  }
+  char keyBuf[kConfigTextMax];
+  char valueBuf[kConfigTextMax];
+  std::string_view key;
+  std::string_view value;
+  if (!fold_case(line.substr(0, split), keyBuf, &key) || !fold_case(rawValue, valueBuf, &value)) {
+    return false;
+  }
+  if (key == "defaults" && value.empty()) {
+    xSemaphoreTake(gConfigWriteLock, portMAX_DELAY);
+    publish_config(Config{});
+    const esp_err_t err = erase_saved_config();
+    xSemaphoreGive(gConfigWriteLock);
+    if (err != ESP_OK) {
+      ESP_LOGW(kTag, "config: defaults applied but saved config not erased: 0x%x", err);
+    } else {
+      ESP_LOGI(kTag, "config: defaults restored");
+    }
+    return true;
+  }
+  const ConfigField* field = find_config_field(key);
+  uint32_t parsed = 0;
+  if (field == nullptr || !parse_config_value(*field, value, &parsed)) {
+    return false;
+  }
+  xSemaphoreTake(gConfigWriteLock, portMAX_DELAY);
+  Config cfg = config_snapshot();
+  field->set(cfg, parsed);
+  if (!config_valid(cfg)) {
+    xSemaphoreGive(gConfigWriteLock);
+    ESP_LOGW(kTag, "config: %.*s=%.*s rejected", static_cast<int>(key.size()), key.data(),
+             static_cast<int>(value.size()), value.data());
+    return true;
+  }
+  publish_config(cfg);
+  const esp_err_t err = save_config(cfg);
+  xSemaphoreGive(gConfigWriteLock);
+  log_config_field(*field, cfg);
+  if (err != ESP_OK) {
+    ESP_LOGW(kTag, "config: applied but not saved: 0x%x", err);
+  }
+  return true;
+}
+
+// Console and BLE text commands. The first word is looked up in kCommands
+// (sorted by name, binary search) and the rest of the line is parsed into
+// CommandArgs according to the command's ArgKind before the handler runs; a
+// handler returns false to have the usage line printed. Adding a command is
+// one handler plus one table row.
+enum class ArgKind : uint8_t {
+  kNone = 0,  // nothing may follow the name
+  kWord = 1,  // optional single word, lowercased (subcommand)
+  kUint = 2,  // optional positive decimal
+  kInt = 3,   // optional signed decimal
+  kText = 4,  // required free text, passed through in its original case
+};
+
+struct CommandArgs {
+  std::string_view rest;  // trimmed remainder of the line
+  std::string_view word;  // kWord only
+  bool hasNumber = false;
+  int32_t number = 0;     // kUint/kInt only
+  InputSource source = InputSource::kSerial;
+};
+
+using CommandHandler = bool (*)(const CommandArgs& args);
+
+struct CommandSpec {
+  std::string_view name;
+  ArgKind arg;
+  CommandHandler handler;
+  const char* usage;
+  bool alias;  // left out of `help`
+};
+
+// Commands run on the console and ble_ingest tasks, so the counters are
+// atomics. totalUs wraps after ~71 minutes of handler time.
+struct CommandStats {
+  std::atomic<uint32_t> calls{0};
+  std::atomic<uint32_t> usageErrors{0};
+  std::atomic<uint32_t> totalUs{0};
+  std::atomic<uint32_t> maxUs{0};
+};
+
+constexpr size_t kCommandNameMax = 15;
+
+static bool parse_int_arg(std::string_view text, int32_t* out) {
+  if (!text.empty() && text.front() == '+') {
+    text.remove_prefix(1);
+  }
+  const char* end = text.data() + text.size();
+  const std::from_chars_result result = std::from_chars(text.data(), end, *out);
+  return !text.empty() && result.ec == std::errc() && result.ptr == end;
+}
+
+static void log_command_help();
+static void log_command_stats();
+
+static bool cmd_status(const CommandArgs&) {
+  log_status();
+  return true;
+}
+
+static bool cmd_get(const CommandArgs& args) {
+  const Config cfg = config_snapshot();
+  if (args.word.empty()) {
+    for (const ConfigField& field : kConfigFields) {
+      log_config_field(field, cfg);
+    }
+    return true;
+  }
+  const ConfigField* field = find_config_field(args.word);
+  if (field == nullptr) {
+    return false;
+  }
+  log_config_field(*field, cfg);
+  return true;
+}
+
+static bool cmd_set(const CommandArgs& args) { return set_config(args.rest); }
+
+static void log_profile(const RecipientProfile& profile) {
+  if (profile.baud == 0) {
+    ESP_LOGI(kTag, "profile: @%s capcode=%lu func=%u baud=default", profile.id,
+             static_cast<unsigned long>(profile.capcode), static_cast<unsigned>(profile.functionBits));
+  } else {
+    ESP_LOGI(kTag, "profile: @%s capcode=%lu func=%u baud=%lu", profile.id,
+             static_cast<unsigned long>(profile.capcode), static_cast<unsigned>(profile.functionBits),
+             static_cast<unsigned long>(profile.baud));
+  }
+}
+
+static bool cmd_profiles(const CommandArgs&) {
+  xSemaphoreTake(gProfileLock, portMAX_DELAY);
+  const size_t count = gProfiles.size();
+  for (size_t i = 0; i < count; ++i) {
+    log_profile(gProfiles.at(i));
+  }
+  xSemaphoreGive(gProfileLock);
+  ESP_LOGI(kTag, "profiles: %u/%u", static_cast<unsigned>(count), static_cast<unsigned>(kMaxProfiles));
+  return true;
+}
+
+// Splits off the first space-separated word of `*rest`.
+static std::string_view take_word(std::string_view* rest) {
+  const size_t split = rest->find(' ');
+  const std::string_view word = rest->substr(0, split);
+  *rest = split == std::string_view::npos ? std::string_view() : trim_view(rest->substr(split + 1));
+  return word;
+}
+
+// "profile add <id> <capcode> [<function> [<baud>]]" or "profile del <id>".
+static bool cmd_profile(const CommandArgs& args) {
+  std::string_view rest;
+  const bool add = match_command_word(args.rest, "add", &rest);
+  if (!add && !match_command_word(args.rest, "del", &rest)) {
+    return false;
+  }
+  RecipientProfile profile = {};
+  if (!parse_profile_id(take_word(&rest), profile.id)) {
+    return false;
+  }
+  esp_err_t err = ESP_OK;
+  if (!add) {
+    if (!rest.empty()) {
+      return false;
+    }
+    xSemaphoreTake(gProfileLock, portMAX_DELAY);
+    const bool removed = gProfiles.remove(profile.id);
+    if (removed) {
+      err = save_profiles_locked();
+    }
+    xSemaphoreGive(gProfileLock);
+    ESP_LOGI(kTag, "profile: @%s %s", profile.id, removed ? "deleted" : "not found");
+  } else {
+    int32_t capcode = -1;
+    int32_t functionBits = config_snapshot().functionBits;
+    int32_t baud = 0;
+    const std::string_view capcodeText = take_word(&rest);
+    const std::string_view functionText = take_word(&rest);
+    const std::string_view baudText = take_word(&rest);
+    if (!rest.empty() || !parse_int_arg(capcodeText, &capcode) ||
+        (!functionText.empty() && !parse_int_arg(functionText, &functionBits)) ||
+        (!baudText.empty() && !parse_int_arg(baudText, &baud)) || capcode < 0 || functionBits < 0 ||
+        functionBits > 3 || baud < 0) {
+      return false;
+    }
+    profile.capcode = static_cast<uint32_t>(capcode);
+    profile.functionBits = static_cast<uint8_t>(functionBits);
+    profile.baud = static_cast<uint32_t>(baud);
+    if (!profile_valid(profile)) {
+      return false;
+    }
+    xSemaphoreTake(gProfileLock, portMAX_DELAY);
+    const bool stored = gProfiles.put(profile);
+    if (stored) {
+      err = save_profiles_locked();
+    }
+    xSemaphoreGive(gProfileLock);
+    if (!stored) {
+      ESP_LOGW(kTag, "profile: table full (%u)", static_cast<unsigned>(kMaxProfiles));
+      return true;
+    }
+    log_profile(profile);
+  }
+  if (err != ESP_OK) {
+    ESP_LOGW(kTag, "profile: applied but not saved: 0x%x", err);
+  }
+  return true;
 }
 
-static bool handle_local_command(const std::string& raw) {
-  const std::string cmd = to_lower_copy(trim_copy(raw));
-  if (cmd.empty()) {
-    return true;
-  }
-  if (cmd == "status") {
-    log_status();
-    return true;
-  }
-  if (cmd == "pm" || cmd == "pm status") {
+static bool cmd_pm(const CommandArgs& args) {
+  if (args.word.empty() || args.word == "status") {
     log_pm_status();
     return true;
   }
-  if (cmd == "pm locks" || cmd == "pm lock") {
+  if (args.word == "locks" || args.word == "lock") {
     log_pm_locks();
     return true;
   }
-  if (cmd == "metrics") {
+  return false;
+}
+
+static bool cmd_sleep(const CommandArgs& args) {
+  if (args.word == "on" || args.word == "off") {
+    set_light_sleep(args.word == "on");
+  } else if (!args.word.empty()) {
+    return false;
+  }
+  log_power_profile("sleep");
+  return true;
+}
+
+static bool cmd_metrics(const CommandArgs& args) {
+  if (args.word.empty()) {
     log_runtime_metrics("manual");
     return true;
   }
-  if (cmd == "txpower" || cmd == "tx power") {
-    log_ble_tx_power_status();
+  if (args.word == "bin") {
+    log_metrics_record();
     return true;
   }
-  if (cmd.rfind("txpower ", 0) == 0 || cmd.rfind("tx power ", 0) == 0) {
-    const std::string rawTrimmed = trim_copy(raw);
-    const size_t prefixLen = cmd.rfind("txpower ", 0) == 0 ? 8U : 9U;
-    const std::string arg = rawTrimmed.size() <= prefixLen ? "" : trim_copy(rawTrimmed.substr(prefixLen));
-    esp_power_level_t level = ESP_PWR_LVL_INVALID;
-    if (arg.empty() || !parse_ble_tx_power_dbm(arg, &level)) {
-      ESP_LOGI(kTag, "Usage: txpower <dbm> where dbm is one of -24,-21,-18,-15,-12,-9,-6,-3,0,3,6,9,12,15,18,20");
-      return true;
-    }
-    gBleTxPowerTarget = level;
-    configure_ble_tx_power();
+  return false;
+}
+
+static bool set_tx_power(bool hasDbm, int32_t dbm) {
+  if (!hasDbm) {
     log_ble_tx_power_status();
     return true;
   }
-  if (cmd == "ble" || cmd == "ble status") {
-    log_ble_status();
-    return true;
+  esp_power_level_t level = ESP_PWR_LVL_INVALID;
+  if (!ble_tx_power_level_from_dbm(dbm, &level)) {
+    return false;
   }
-  if (cmd == "ble restart") {
-    if (gBleConnHandle != BLE_HS_CONN_HANDLE_NONE) {
-      ESP_LOGI(kTag, "ble: restart ignored while connected");
-      return true;
-    }
-    const int stopRc = ble_gap_adv_stop();
-    if (stopRc != 0 && stopRc != BLE_HS_EALREADY) {
-      ESP_LOGW(kTag, "ble_gap_adv_stop rc=%d", stopRc);
-    }
-    gBleAdvertising = false;
-    start_ble_advertising(AdvProfile::kFastReconnect);
-    return true;
+  gBleTxPowerTarget = level;
+  configure_ble_tx_power();
+  log_ble_tx_power_status();
+  return true;
+}
+
+static bool cmd_txpower(const CommandArgs& args) { return set_tx_power(args.hasNumber, args.number); }
+
+// "tx power [<dbm>]", the spelled-out form of txpower.
+static bool cmd_tx(const CommandArgs& args) {
+  std::string_view dbmText;
+  if (!match_command_word(args.rest, "power", &dbmText)) {
+    return false;
   }
-  if (cmd == "help" || cmd == "?") {
-    ESP_LOGI(kTag, "Commands: status | pm | pm locks | metrics | txpower [<dbm>] | ble [status|restart] | ping | reboot | send <message> | help");
+  int32_t dbm = 0;
+  if (!dbmText.empty() && !parse_int_arg(dbmText, &dbm)) {
+    return false;
+  }
+  return set_tx_power(!dbmText.empty(), dbm);
+}
+
+// Console only: a long run would hold up the BLE ingest task and every write
+// queued behind it.
+static bool cmd_txbench(const CommandArgs& args) {
+  if (args.source == InputSource::kBle) {
+    ESP_LOGW(kTag, "txbench is only available on the serial console");
     return true;
   }
-  if (cmd == "ping") {
-    ESP_LOGI(kTag, "PONG");
+  run_tx_bench(args.hasNumber ? static_cast<uint32_t>(args.number) : kTxBenchDefaultPages);
+  return true;
+}
+
+static bool cmd_ble(const CommandArgs& args) {
+  if (args.word.empty() || args.word == "status") {
+    log_ble_status();
     return true;
   }
-  if (cmd == "reboot" || cmd == "restart") {
-    ESP_LOGW(kTag, "Reboot requested");
-    esp_restart();
+  if (args.word != "restart") {
+    return false;
+  }
+  if (gBleConnHandle.load(std::memory_order_acquire) != BLE_HS_CONN_HANDLE_NONE) {
+    ESP_LOGI(kTag, "ble: restart ignored while connected");
     return true;
   }
+  const int stopRc = ble_gap_adv_stop();
+  if (stopRc != 0 && stopRc != BLE_HS_EALREADY) {
+    ESP_LOGW(kTag, "ble_gap_adv_stop rc=%d", stopRc);
+  }
+  gBleAdvertising = false;
+  start_ble_advertising(AdvProfile::kFastReconnect);
+  return true;
+}
+
+static bool cmd_help(const CommandArgs&) {
+  log_command_help();
+  return true;
+}
+
+static bool cmd_commands(const CommandArgs&) {
+  log_command_stats();
+  return true;
+}
+
+static bool cmd_ping(const CommandArgs&) {
+  ESP_LOGI(kTag, "PONG");
+  return true;
+}
+
+static bool cmd_reboot(const CommandArgs&) {
+  ESP_LOGW(kTag, "Reboot requested");
+  esp_restart();
+  return true;
+}
+
+// Page commands take the text as a view into the ingest buffer, so a SEND
+// line goes to the job pool without touching the heap.
+static bool cmd_send(const CommandArgs& args) {
+  enqueue_message_page(args.rest, TxPriority::kNormal);
+  return true;
+}
+
+static bool cmd_urgent(const CommandArgs& args) {
+  enqueue_message_page(args.rest, TxPriority::kUrgent);
+  return true;
+}
+
+// Keep sorted by name; checked at compile time below.
+constexpr CommandSpec kCommands[] = {
+    {"?", ArgKind::kNone, cmd_help, "help", true},
+    {"ble", ArgKind::kWord, cmd_ble, "ble [status|restart]", false},
+    {"commands", ArgKind::kNone, cmd_commands, "commands", false},
+    {"get", ArgKind::kWord, cmd_get, "get [<key>]", false},
+    {"help", ArgKind::kNone, cmd_help, "help", false},
+    {"metrics", ArgKind::kWord, cmd_metrics, "metrics [bin]", false},
+    {"ping", ArgKind::kNone, cmd_ping, "ping", false},
+    {"pm", ArgKind::kWord, cmd_pm, "pm [status|locks]", false},
+    {"profile", ArgKind::kText, cmd_profile, "profile add <id> <capcode> [<function> [<baud>]] | profile del <id>",
+     false},
+    {"profiles", ArgKind::kNone, cmd_profiles, "profiles", false},
+    {"reboot", ArgKind::kNone, cmd_reboot, "reboot", false},
+    {"restart", ArgKind::kNone, cmd_reboot, "reboot", true},
+    {"send", ArgKind::kText, cmd_send, "send [@<profile>] <message>", false},
+    {"set", ArgKind::kText, cmd_set, "set <key> <value> | set defaults (keys: see get)", false},
+    {"sleep", ArgKind::kWord, cmd_sleep, "sleep [on|off]", false},
+    {"status", ArgKind::kNone, cmd_status, "status", false},
+    {"tx", ArgKind::kText, cmd_tx, "tx power [<dbm>]", true},
+    {"txbench", ArgKind::kUint, cmd_txbench, "txbench [pages]", false},
+    {"txpower", ArgKind::kInt, cmd_txpower,
+     "txpower [<dbm>] where dbm is one of -24,-21,-18,-15,-12,-9,-6,-3,0,3,6,9,12,15,18,20", false},
+    {"urgent", ArgKind::kText, cmd_urgent, "urgent [@<profile>] <message>", false},
+};
+constexpr size_t kCommandCount = sizeof(kCommands) / sizeof(kCommands[0]);
+
+constexpr bool commands_sorted() {
+  for (size_t i = 1; i < kCommandCount; ++i) {
+    if (!(kCommands[i - 1].name < kCommands[i].name) || kCommands[i].name.size() > kCommandNameMax) {
+      return false;
+    }
+  }
+  return true;
+}
+static_assert(commands_sorted(), "kCommands must be sorted by name, names at most kCommandNameMax chars");
+
+static CommandStats gCommandStats[kCommandCount];
+
+static bool parse_command_args(const CommandSpec& spec, CommandArgs* args, char* wordBuf) {
+  switch (spec.arg) {
+    case ArgKind::kNone:
+      return args->rest.empty();
+    case ArgKind::kWord:
+      if (args->rest.size() > kCommandNameMax || args->rest.find(' ') != std::string_view::npos) {
+        return false;
+      }
+      for (size_t i = 0; i < args->rest.size(); ++i) {
+        wordBuf[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(args->rest[i])));
+      }
+      args->word = std::string_view(wordBuf, args->rest.size());
+      return true;
+    case ArgKind::kUint:
+    case ArgKind::kInt:
+      if (args->rest.empty()) {
+        return true;
+      }
+      if (!parse_int_arg(args->rest, &args->number) || (spec.arg == ArgKind::kUint && args->number <= 0)) {
+        return false;
+      }
+      args->hasNumber = true;
+      return true;
+    case ArgKind::kText:
+      return !args->rest.empty();
+  }
   return false;
 }
 
-static void process_input_line(const std::string& rawLine, InputSource source) {
-  const std::string trimmed = trim_copy(rawLine);
-  if (trimmed.empty()) {
-    return;
+// Returns false when the first word is not a registered command.
+static bool dispatch_command(std::string_view line, InputSource source) {
+  const size_t nameEnd = line.find(' ');
+  const std::string_view rawName = line.substr(0, nameEnd);
+  if (rawName.size() > kCommandNameMax) {
+    return false;
+  }
+  char nameBuf[kCommandNameMax];
+  for (size_t i = 0; i < rawName.size(); ++i) {
+    nameBuf[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(rawName[i])));
+  }
+  const std::string_view name(nameBuf, rawName.size());
+  const CommandSpec* const end = kCommands + kCommandCount;
+  const CommandSpec* spec = std::lower_bound(
+      kCommands, end, name, [](const CommandSpec& entry, std::string_view key) { return entry.name < key; });
+  if (spec == end || spec->name != name) {
+    return false;
   }
 
-  const std::string lowered = to_lower_copy(trimmed);
-  if (handle_local_command(trimmed)) {
-    return;
+  CommandArgs args;
+  args.source = source;
+  if (nameEnd != std::string_view::npos) {
+    args.rest = trim_view(line.substr(nameEnd));
+  }
+  char wordBuf[kCommandNameMax];
+  const int64_t startUs = esp_timer_get_time();
+  const bool ok = parse_command_args(*spec, &args, wordBuf) && spec->handler(args);
+  const uint32_t elapsedUs = static_cast<uint32_t>(esp_timer_get_time() - startUs);
+  if (!ok) {
+    ESP_LOGI(kTag, "Usage: %s", spec->usage);
   }
 
-  if (lowered == "send") {
-    ESP_LOGI(kTag, "Usage: send <message>");
-    return;
+  CommandStats& stats = gCommandStats[spec - kCommands];
+  stats.calls.fetch_add(1, std::memory_order_relaxed);
+  stats.usageErrors.fetch_add(ok ? 0 : 1, std::memory_order_relaxed);
+  stats.totalUs.fetch_add(elapsedUs, std::memory_order_relaxed);
+  uint32_t seen = stats.maxUs.load(std::memory_order_relaxed);
+  while (elapsedUs > seen && !stats.maxUs.compare_exchange_weak(seen, elapsedUs, std::memory_order_relaxed)) {
   }
+  return true;
+}
 
-  if (lowered.rfind("send ", 0) == 0) {
-    const std::string payload = trim_copy(trimmed.substr(4));
-    if (payload.empty()) {
-      ESP_LOGI(kTag, "Usage: send <message>");
-    } else {
-      const TickType_t waitTicks = source == InputSource::kBle ? 0 : pdMS_TO_TICKS(200);
-      enqueue_message_page(payload, waitTicks);
+static void log_command_help() {
+  char line[256];
+  size_t used = std::snprintf(line, sizeof(line), "Commands:");
+  for (const CommandSpec& spec : kCommands) {
+    if (spec.alias) {
+      continue;
+    }
+    // Only the leading "name [args]" part of long usage strings.
+    const char* usageEnd = std::strstr(spec.usage, " where ");
+    const int usageLen = usageEnd == nullptr ? static_cast<int>(std::strlen(spec.usage))
+                                             : static_cast<int>(usageEnd - spec.usage);
+    const int written = std::snprintf(line + used, sizeof(line) - used, "%s %.*s", used > 9 ? " |" : "",
+                                      usageLen, spec.usage);
+    if (written < 0 || used + static_cast<size_t>(written) >= sizeof(line)) {
+      break;
+    }
+    used += static_cast<size_t>(written);
+  }
+  ESP_LOGI(kTag, "%s", line);
+}
+
+static void log_command_stats() {
+  for (size_t i = 0; i < kCommandCount; ++i) {
+    const CommandStats& stats = gCommandStats[i];
+    const uint32_t calls = stats.calls.load(std::memory_order_relaxed);
+    if (calls == 0) {
+      continue;
     }
+    ESP_LOGI(kTag, "commands: %-8.*s calls=%lu usage_err=%lu avg=%luus max=%luus",
+             static_cast<int>(kCommands[i].name.size()), kCommands[i].name.data(), static_cast<unsigned long>(calls),
+             static_cast<unsigned long>(stats.usageErrors.load(std::memory_order_relaxed)),
+             static_cast<unsigned long>(stats.totalUs.load(std::memory_order_relaxed) / calls),
+             static_cast<unsigned long>(stats.maxUs.load(std::memory_order_relaxed)));
+  }
+}
+
+static void process_input_line(std::string_view rawLine, InputSource source) {
+  const std::string_view line = trim_view(rawLine);
+  if (line.empty() || dispatch_command(line, source)) {
     return;
   }
 
   if (source == InputSource::kBle) {
-    ESP_LOGW(kTag, "BLE unknown command: %s", trimmed.c_str());
+    ESP_LOGW(kTag, "BLE unknown command: %.*s", static_cast<int>(line.size()), line.data());
   } else {
-    ESP_LOGI(kTag, "Unknown command. Use: send <message>, status, pm, pm locks, metrics, txpower, ble, ping, reboot, help");
+    ESP_LOGI(kTag, "Unknown command: %.*s (type help for the list)", static_cast<int>(line.size()), line.data());
   }
 }
 
-static void process_input_payload(const std::string& payload, InputSource source) {
-  size_t start = 0;
-  while (start <= payload.size()) {
-    const size_t end = payload.find('\n', start);
-    std::string line = end == std::string::npos ? payload.substr(start)
-                                                 : payload.substr(start, end - start);
+static void process_input_payload(std::string_view payload, InputSource source) {
+  while (true) {
+    const size_t end = payload.find('\n');
+    std::string_view line = payload.substr(0, end);
     if (!line.empty() && line.back() == '\r') {
-      line.pop_back();
+      line.remove_suffix(1);
     }
     process_input_line(line, source);
-    if (end == std::string::npos) {
+    if (end == std::string_view::npos) {
       break;
     }
-    start = end + 1;
+    payload.remove_prefix(end + 1);
   }
 }
 
+// A transmission slot: the encoded frame and the jobs packed into it. The
+// worker double-buffers slots so job N+1 is encoded while job N is on air.
+struct TxSlot {
+  PocsagFrame frame;
+  std::vector<TxJob*> jobs;
+  int64_t dequeuedUs = 0;
+  int64_t startedUs = 0;
+  uint32_t leadUs = 0;
+};
+
+static void complete_tx_slot(TxSlot& slot, bool ok, int64_t doneUs) {
+  TxEvent event = {};
+  event.type = ok ? TxEventType::kDone : TxEventType::kFail;
+  event.jobs = slot.jobs.data();
+  event.jobCount = slot.jobs.size();
+  event.batches = slot.frame.batches;
+  event.leadUs = slot.leadUs;
+  event.airtimeUs = slot.startedUs > 0 && doneUs > slot.startedUs ? static_cast<uint32_t>(doneUs - slot.startedUs) : 0;
+  tx_events_publish(event);
+  for (TxJob* job : slot.jobs) {
+    gTxJobPool.release(job);
+  }
+  slot.jobs.clear();
+}
+
+// Producers and the RMT completion callback both wake the worker through
+// notification bits, so it can keep packing/encoding while a frame is on air.
 static void tx_worker_task(void*) {
+  std::vector<TxJob*> pending;
+  pending.reserve(kMaxPackedPages);
+  static PocsagBatchPacker packer;
+  std::array<TxSlot, 2> slots;
+  for (TxSlot& slot : slots) {
+    slot.jobs.reserve(kMaxPackedPages);
+    slot.frame.bits.reserve_bits(kMaxPreambleBits + kMaxBatchesLimit * kBatchBits);
+  }
+  TxSlot* onAir = nullptr;
+  TxSlot* next = nullptr;
+  int64_t lastDoneUs = 0;
+  HeardFrame heard;
+  uint32_t cfgVersion = gConfigVersion.load(std::memory_order_acquire);
+  Config cfg = config_snapshot();
+
   while (true) {
-    TxJob* job = nullptr;
-    if (xQueueReceive(gTxQueue, &job, portMAX_DELAY) == pdTRUE && job != nullptr) {
-      bool ok = gWaveTx.transmit_bits(job->bits, gConfig);
-      ESP_LOGI(kTag, "%s", ok ? "TX_DONE" : "TX_FAIL");
-      delete job;
+    // A new Config is only adopted with nothing built or on air, so every
+    // frame is encoded and clocked out with the settings it was built for.
+    if (onAir == nullptr && next == nullptr && gConfigVersion.load(std::memory_order_relaxed) != cfgVersion) {
+      cfgVersion = gConfigVersion.load(std::memory_order_acquire);
+      const Config previous = cfg;
+      cfg = config_snapshot();
+      if (cfg.dataGpio != previous.dataGpio || cfg.output != previous.output || cfg.idleHigh != previous.idleHigh) {
+        gWaveTx.release();
+        if (cfg.dataGpio != previous.dataGpio) {
+          // Stop driving the old pin; it goes back to its reset (input) state.
+          gpio_reset_pin(static_cast<gpio_num_t>(previous.dataGpio));
+        }
+        set_idle_line(cfg.dataGpio, cfg.output, cfg.idleHigh);
+      } else if (!cfg.keepRmtChannel) {
+        gWaveTx.release();
+      }
+      ESP_LOGI(kTag, "TX worker adopted config v%lu", static_cast<unsigned long>(cfgVersion));
+    }
+
+    // Everything already waiting shares the next transmission's preamble.
+    // Only filled when a frame is about to be built, so pages queued while
+    // one is on air are still in the scheduler when the next is packed.
+    if (next == nullptr) {
+      while (pending.size() < kMaxPackedPages) {
+        TxJob* job = gTxScheduler.pop();
+        if (job == nullptr) {
+          break;
+        }
+        pending.push_back(job);
+      }
+      // A full pending list would make a more urgent page that arrived late
+      // wait a whole frame: trade it for the newest least urgent pending job.
+      while (pending.size() == kMaxPackedPages) {
+        size_t worst = 0;
+        for (size_t i = 1; i < pending.size(); ++i) {
+          if (pending[i]->priority >= pending[worst]->priority) {
+            worst = i;
+          }
+        }
+        if (gTxScheduler.top_level() >= static_cast<size_t>(pending[worst]->priority) ||
+            !gTxScheduler.unpop(pending[worst])) {
+          break;
+        }
+        pending.erase(pending.begin() + static_cast<std::ptrdiff_t>(worst));
+        TxJob* job = gTxScheduler.pop();
+        if (job != nullptr) {
+          pending.push_back(job);
+        }
+      }
+    }
+    if (!pending.empty()) {
+      // Woken with work (possibly out of light sleep): stay awake until the
+      // pipeline drains.
+      gTxBusyLock.acquire();
+    }
+
+    if (next == nullptr && !pending.empty()) {
+      next = onAir == &slots[0] ? &slots[1] : &slots[0];
+      next->dequeuedUs = esp_timer_get_time();
+      {
+        ScopedPmLock cpuMax(gTxCpuLock);
+        pack_pending_jobs(pending, next->jobs, cfg, packer, next->frame);
+        const uint32_t preambleBits =
+            select_preamble_bits(cfg, heard, onAir != nullptr, lastDoneUs, next->jobs, next->frame.baud);
+        encode_packed_frame(cfg, preambleBits, packer, next->frame);
+      }
+      metrics_record_encode(static_cast<uint32_t>(esp_timer_get_time() - next->dequeuedUs));
+      if (next->frame.truncated) {
+        ESP_LOGW(kTag, "Message truncated to %u batches", static_cast<unsigned>(next->frame.batches));
+      }
+    }
+
+    if (onAir == nullptr && next != nullptr) {
+      // Lead time counts from when this slot could first have gone on air.
+      const int64_t eligibleUs = next->dequeuedUs > lastDoneUs ? next->dequeuedUs : lastDoneUs;
+      gTxApbLock.acquire();
+      bool started = false;
+      {
+        ScopedPmLock cpuMax(gTxCpuLock);
+        started = gWaveTx.start_frame(next->frame, cfg);
+      }
+      if (started) {
+        next->startedUs = gWaveTx.last_start_us();
+        const int64_t leadUs = next->startedUs - eligibleUs;
+        next->leadUs = leadUs > 0 ? static_cast<uint32_t>(leadUs) : 0;
+        metrics_record_tx_lead(gWaveTx.last_start_warm(), next->leadUs);
+        metrics_record_preamble(cfg, next->frame, lastDoneUs > 0 ? next->startedUs - lastDoneUs : 0);
+        record_heard_frame(next->frame, next->jobs, &heard);
+        for (const TxJob* job : next->jobs) {
+          const uint32_t waitedUs = static_cast<uint32_t>(next->startedUs - job->queuedUs);
+          gTxLatency.write([waitedUs](TxLatencyMetrics& latency) {
+            latency.samples++;
+            latency.totalUs += waitedUs;
+            latency.lastUs = waitedUs;
+            if (waitedUs > latency.maxUs) {
+              latency.maxUs = waitedUs;
+            }
+          });
+        }
+        TxEvent event = {};
+        event.type = TxEventType::kOnAir;
+        event.jobs = next->jobs.data();
+        event.jobCount = next->jobs.size();
+        event.batches = next->frame.batches;
+        event.leadUs = next->leadUs;
+        tx_events_publish(event);
+        onAir = next;
+      } else {
+        gTxApbLock.release();
+        next->startedUs = 0;
+        next->leadUs = 0;
+        complete_tx_slot(*next, false, esp_timer_get_time());
+      }
+      next = nullptr;
+      continue;
+    }
+
+    const bool idle = onAir == nullptr && next == nullptr && pending.empty();
+    if (idle) {
+      gTxBusyLock.release();
+    }
+    const bool timedRelease = idle && gWaveTx.holding_channel() && cfg.rmtReleaseIdleMs > 0;
+    const TickType_t waitTicks = timedRelease ? pdMS_TO_TICKS(cfg.rmtReleaseIdleMs) : portMAX_DELAY;
+    uint32_t notified = 0;
+    if (xTaskNotifyWait(0, kTxNotifyJob | kTxNotifyDone | kTxNotifyConfig, &notified, waitTicks) != pdTRUE) {
+      if (timedRelease && gTxScheduler.depth() == 0) {
+        gWaveTx.release();
+        ESP_LOGI(kTag, "RMT channel released after %lums idle",
+                 static_cast<unsigned long>(cfg.rmtReleaseIdleMs));
+      }
+      continue;
+    }
+    if ((notified & kTxNotifyDone) != 0 && onAir != nullptr) {
+      const bool ok = gWaveTx.finish_frame(cfg);
+      gTxApbLock.release();
+      lastDoneUs = esp_timer_get_time();
+      complete_tx_slot(*onAir, ok, lastDoneUs);
+      onAir = nullptr;
     }
   }
 }
 
+// Runs on the NimBLE host task: only hand the write to the parser task so ATT
+// responses and connection events are never held up by command processing.
 static int ble_rx_access(uint16_t, uint16_t, ble_gatt_access_ctxt* ctxt, void*) {
   if (ctxt->op != BLE_GATT_ACCESS_OP_WRITE_CHR) {
     return BLE_ATT_ERR_UNLIKELY;
   }
+  const uint32_t length = OS_MBUF_PKTLEN(ctxt->om);
+  const int64_t nowUs = esp_timer_get_time();
+  gBleLink.write([&](BleLinkMetrics& link) {
+    if (link.rxWrites == 0) {
+      link.firstWriteUs = nowUs;
+    }
+    link.rxWrites++;
+    link.rxBytes += length;
+    link.lastWriteUs = nowUs;
+    if (length > link.maxWriteBytes) {
+      link.maxWriteBytes = length;
+    }
+    if (length + 3 > link.mtu) {
+      link.longWrites++;
+    }
+  });
+  if (!gBleIngest.push(ctxt->om)) {
+    return BLE_ATT_ERR_INSUFFICIENT_RES;
+  }
+  if (gBleIngestTask != nullptr) {
+    xTaskNotifyGive(gBleIngestTask);
+  }
+  return 0;
+}
 
-  const int length = OS_MBUF_PKTLEN(ctxt->om);
-  if (length <= 0) {
-    return 0;
+static void ble_ingest_task(void*) {
+  while (true) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    const BleIngestRing::Slot* slot = nullptr;
+    while ((slot = gBleIngest.peek()) != nullptr) {
+      const uint32_t allocsBefore = gBleIngestAllocs.load(std::memory_order_relaxed);
+      if (pager_proto::is_binary_frame(slot->data, slot->length)) {
+        process_binary_frame(slot->data, slot->length);
+      } else {
+        process_input_payload(std::string_view(slot->data, slot->length), InputSource::kBle);
+      }
+      gBleIngest.pop();
+      if (!kCountCxxAllocs) {
+        continue;
+      }
+      const uint32_t allocs = gBleIngestAllocs.load(std::memory_order_relaxed) - allocsBefore;
+      gBleRxAllocMetrics.write([allocs](BleRxAllocMetrics& m) {
+        m.writes++;
+        m.allocs += allocs;
+        m.lastWriteAllocs = allocs;
+        if (allocs > m.maxWriteAllocs) {
+          m.maxWriteAllocs = allocs;
+        }
+      });
+    }
+    // Off the host task: a profile switch may take a mutex and start a GAP
+    // parameter update.
+    ble_conn_note_activity();
   }
+}
 
-  std::string payload(static_cast<size_t>(length), '\0');
-  const int copyRc =
-      os_mbuf_copydata(ctxt->om, 0, length, reinterpret_cast<void*>(payload.data()));
-  if (copyRc != 0) {
+static int ble_status_access(uint16_t, uint16_t, ble_gatt_access_ctxt* ctxt, void*) {
+  if (ctxt->op != BLE_GATT_ACCESS_OP_READ_CHR) {
     return BLE_ATT_ERR_UNLIKELY;
   }
 
-  process_input_payload(payload, InputSource::kBle);
+  // Clients that find " BIN1" may send binary frames; " ACK1" means delivery
+  // reports are notified on this characteristic; " PRF1" means binary frames
+  // may address recipient profiles (pager_protocol.h).
+  constexpr char kStatus[] = "READY BIN1 ACK1 PRF1";
+  if (os_mbuf_append(ctxt->om, kStatus, sizeof(kStatus) - 1) != 0) {
+    return BLE_ATT_ERR_INSUFFICIENT_RES;
+  }
   return 0;
 }
 
-static int ble_status_access(uint16_t, uint16_t, ble_gatt_access_ctxt* ctxt, void*) {
+// One pager_proto metrics record per read; NimBLE serves long reads from the
+// same callback, so clients on the default MTU still get the whole record.
+static int ble_metrics_access(uint16_t, uint16_t, ble_gatt_access_ctxt* ctxt, void*) {
   if (ctxt->op != BLE_GATT_ACCESS_OP_READ_CHR) {
     return BLE_ATT_ERR_UNLIKELY;
   }
-
-  constexpr char kStatus[] = "READY";
-  if (os_mbuf_append(ctxt->om, kStatus, sizeof(kStatus) - 1) != 0) {
+  pager_proto::MetricsRecord record;
+  build_metrics_record(&record);
+  uint8_t bytes[pager_proto::kMetricsMaxBytes];
+  const size_t length = pager_proto::write_metrics_record(record, bytes);
+  if (os_mbuf_append(ctxt->om, bytes, length) != 0) {
     return BLE_ATT_ERR_INSUFFICIENT_RES;
   }
   return 0;
@@ -967,6 +3767,12 @@ static ble_gatt_chr_def gBleCharacteristics[] = {
         .uuid = &kStatusUuid.u,
         .access_cb = ble_status_access,
         .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY,
+        .val_handle = &gBleStatusValHandle,
+    },
+    {
+        .uuid = &kMetricsUuid.u,
+        .access_cb = ble_metrics_access,
+        .flags = BLE_GATT_CHR_F_READ,
     },
     {
         0,
@@ -1026,17 +3832,173 @@ static void configure_ble_tx_power() {
            ble_tx_power_dbm(gBleTxPowerTarget), advDbm, defaultDbm);
 }
 
+static void log_ble_link(const char* reason) {
+  const BleLinkMetrics link = gBleLink.read();
+  const int64_t spanUs = link.lastWriteUs - link.firstWriteUs;
+  const unsigned long bytesPerSec =
+      spanUs > 0 ? static_cast<unsigned long>((static_cast<uint64_t>(link.rxBytes) * 1000000ULL) / spanUs) : 0;
+  ESP_LOGI(kTag, "ble link[%s]: mtu=%u dle tx=%u/%uus rx=%u/%uus", reason, static_cast<unsigned>(link.mtu),
+           static_cast<unsigned>(link.dleTxOctets), static_cast<unsigned>(link.dleTxTimeUs),
+           static_cast<unsigned>(link.dleRxOctets), static_cast<unsigned>(link.dleRxTimeUs));
+  ESP_LOGI(kTag, "ble link[%s]: writes=%lu bytes=%lu max_write=%lu long_writes=%lu rate=%luB/s", reason,
+           static_cast<unsigned long>(link.rxWrites), static_cast<unsigned long>(link.rxBytes),
+           static_cast<unsigned long>(link.maxWriteBytes), static_cast<unsigned long>(link.longWrites), bytesPerSec);
+}
+
+// Call inside link_metrics_write(gConnMetrics, ...).
+static void conn_metrics_apply(ConnProfileMetrics& conn, ConnProfile profile, uint64_t nowUs) {
+  if (conn.sinceUs != 0) {
+    conn.timeUs[static_cast<size_t>(conn.applied)] += nowUs - conn.sinceUs;
+  }
+  if (profile != conn.applied) {
+    conn.switches++;
+  }
+  conn.applied = profile;
+  conn.sinceUs = nowUs;
+}
+
+static ConnProfile classify_conn_interval(uint16_t interval) {
+  for (const ConnProfile profile : {ConnProfile::kBurst, ConnProfile::kIdle}) {
+    const ConnProfileConfig cfg = get_conn_profile_config(profile);
+    if (interval >= cfg.intervalMin && interval <= cfg.intervalMax) {
+      return profile;
+    }
+  }
+  return ConnProfile::kCentral;
+}
+
+static void ble_conn_request_profile(ConnProfile profile) {
+  const uint16_t connHandle = gBleConnHandle.load(std::memory_order_acquire);
+  if (connHandle == BLE_HS_CONN_HANDLE_NONE) {
+    return;
+  }
+  bool already = false;
+  link_metrics_write(gConnMetrics, [&](ConnProfileMetrics& conn) {
+    already = conn.requested == profile;
+    conn.requested = profile;
+  });
+  if (already) {
+    return;
+  }
+
+  const ConnProfileConfig cfg = get_conn_profile_config(profile);
+  ble_gap_upd_params params = {};
+  params.itvl_min = cfg.intervalMin;
+  params.itvl_max = cfg.intervalMax;
+  params.latency = cfg.latency;
+  params.supervision_timeout = cfg.supervisionTimeout;
+  const int rc = ble_gap_update_params(connHandle, &params);
+  if (rc != 0) {
+    link_metrics_write(gConnMetrics, [](ConnProfileMetrics& conn) {
+      conn.failures++;
+      conn.requested = conn.applied;
+    });
+    ESP_LOGW(kTag, "ble_gap_update_params(%s) rc=%d", cfg.label, rc);
+  }
+}
+
+// Writes only stamp gConnActivityMs; the burst profile is requested once, on
+// the idle->active transition, and the idle timer (armed then) decides when
+// to drop back: after kConnIdleAfterMs without writes and with nothing
+// waiting to go on air.
+static void ble_conn_note_activity() {
+  gConnActivityMs.store(static_cast<uint32_t>(esp_timer_get_time() / 1000), std::memory_order_relaxed);
+  if (gConnBurst.exchange(true, std::memory_order_acq_rel)) {
+    return;
+  }
+  ble_conn_request_profile(ConnProfile::kBurst);
+  if (gConnIdleTimer != nullptr) {
+    esp_timer_stop(gConnIdleTimer);
+    esp_timer_start_once(gConnIdleTimer, static_cast<uint64_t>(kConnIdleAfterMs) * 1000ULL);
+  }
+}
+
+static void ble_conn_idle_timer_cb(void*) {
+  if (gBleConnHandle.load(std::memory_order_acquire) == BLE_HS_CONN_HANDLE_NONE) {
+    gConnBurst.store(false, std::memory_order_release);
+    return;
+  }
+  const uint32_t nowMs = static_cast<uint32_t>(esp_timer_get_time() / 1000);
+  const uint32_t quietMs = nowMs - gConnActivityMs.load(std::memory_order_relaxed);
+  if (quietMs < kConnIdleAfterMs || gTxJobPool.stats().inUse > 0) {
+    // Still active. Re-requesting burst is a no-op unless a switch to idle
+    // raced with the write that kept the link busy.
+    ble_conn_request_profile(ConnProfile::kBurst);
+    const uint32_t waitMs = quietMs < kConnIdleAfterMs ? kConnIdleAfterMs - quietMs : kConnIdleAfterMs;
+    esp_timer_start_once(gConnIdleTimer, static_cast<uint64_t>(waitMs) * 1000ULL);
+    return;
+  }
+  gConnBurst.store(false, std::memory_order_release);
+  ble_conn_request_profile(ConnProfile::kIdle);
+}
+
+static void log_conn_profile(const char* reason) {
+  const uint64_t nowUs = static_cast<uint64_t>(esp_timer_get_time());
+  ConnProfileMetrics conn = gConnMetrics.read();
+  if (conn.sinceUs != 0 && gBleConnHandle.load(std::memory_order_acquire) != BLE_HS_CONN_HANDLE_NONE) {
+    conn.timeUs[static_cast<size_t>(conn.applied)] += nowUs - conn.sinceUs;
+  }
+  ESP_LOGI(kTag, "%s: conn_profile now=%s itvl=%.2fms latency=%u timeout=%ums switches=%lu failures=%lu",
+           reason, get_conn_profile_config(conn.applied).label, conn.interval * 1.25f,
+           static_cast<unsigned>(conn.latency), static_cast<unsigned>(conn.timeout) * 10U,
+           static_cast<unsigned long>(conn.switches), static_cast<unsigned long>(conn.failures));
+  ESP_LOGI(kTag, "%s: conn_profile time burst=%llus idle=%llus central=%llus", reason,
+           static_cast<unsigned long long>(conn.timeUs[static_cast<size_t>(ConnProfile::kBurst)] / 1000000ULL),
+           static_cast<unsigned long long>(conn.timeUs[static_cast<size_t>(ConnProfile::kIdle)] / 1000000ULL),
+           static_cast<unsigned long long>(conn.timeUs[static_cast<size_t>(ConnProfile::kCentral)] / 1000000ULL));
+}
+
+// The negotiated value is recorded from BLE_GAP_EVENT_MTU; only failures matter here.
+static int ble_on_mtu_exchanged(uint16_t connHandle, const ble_gatt_error* error, uint16_t, void*) {
+  if (error != nullptr && error->status != 0) {
+    ESP_LOGW(kTag, "BLE MTU exchange failed; handle=%u status=%u", static_cast<unsigned>(connHandle),
+             static_cast<unsigned>(error->status));
+  }
+  return 0;
+}
+
+// Peripheral-initiated link setup: ask for a larger ATT MTU so page writes fit
+// in a single Write Request, and for LE Data Length Extension so each ATT PDU
+// goes out in one link-layer packet.
+static void ble_negotiate_link(uint16_t connHandle) {
+  const int mtuRc = ble_gattc_exchange_mtu(connHandle, ble_on_mtu_exchanged, nullptr);
+  if (mtuRc != 0) {
+    ESP_LOGW(kTag, "ble_gattc_exchange_mtu rc=%d", mtuRc);
+  }
+  const int dleRc = ble_gap_set_data_len(connHandle, kBleDleTxOctets, kBleDleTxTimeUs);
+  if (dleRc != 0) {
+    ESP_LOGW(kTag, "ble_gap_set_data_len rc=%d", dleRc);
+  }
+}
+
 static int ble_gap_event(struct ble_gap_event* event, void*) {
   switch (event->type) {
     case BLE_GAP_EVENT_CONNECT:
       if (event->connect.status == 0) {
-        gBleConnHandle = event->connect.conn_handle;
+        if (gAdvDisconnectUs != 0) {
+          const int64_t delayUs = esp_timer_get_time() - gAdvDisconnectUs;
+          gAdvDisconnectUs = 0;
+          adv_record_reconnect(static_cast<uint32_t>(delayUs / 1000), gAdvProfile);
+        }
+        gBleConnHandle.store(event->connect.conn_handle, std::memory_order_release);
         gBleAdvertising = false;
         metrics_set_connected(true);
         metrics_set_advertising(false);
-        ESP_LOGI(kTag, "BLE connected; handle=%u", static_cast<unsigned>(gBleConnHandle));
+        const int64_t connectUs = esp_timer_get_time();
+        gBleLink.write([connectUs](BleLinkMetrics& link) {
+          link = {};
+          link.connectUs = connectUs;
+        });
+        link_metrics_write(gConnMetrics, [connectUs](ConnProfileMetrics& conn) {
+          conn.requested = ConnProfile::kCentral;
+          conn_metrics_apply(conn, ConnProfile::kCentral, static_cast<uint64_t>(connectUs));
+        });
+        ESP_LOGI(kTag, "BLE connected; handle=%u", static_cast<unsigned>(event->connect.conn_handle));
+        ble_negotiate_link(event->connect.conn_handle);
+        // A fresh connection usually means a write is about to follow.
+        ble_conn_note_activity();
       } else {
-        gBleConnHandle = BLE_HS_CONN_HANDLE_NONE;
+        gBleConnHandle.store(BLE_HS_CONN_HANDLE_NONE, std::memory_order_release);
         metrics_set_connected(false);
         ESP_LOGW(kTag, "BLE connect failed; status=%d", event->connect.status);
         start_ble_advertising(AdvProfile::kFastReconnect);
@@ -1044,20 +4006,93 @@ static int ble_gap_event(struct ble_gap_event* event, void*) {
       return 0;
     case BLE_GAP_EVENT_DISCONNECT:
       ESP_LOGI(kTag, "BLE disconnected; reason=%d", event->disconnect.reason);
-      gBleConnHandle = BLE_HS_CONN_HANDLE_NONE;
+      log_ble_link("closed");
+      gBleStatusSubscribed.store(false, std::memory_order_release);
+      if (gConnIdleTimer != nullptr) {
+        esp_timer_stop(gConnIdleTimer);
+      }
+      gConnBurst.store(false, std::memory_order_release);
+      link_metrics_write(gConnMetrics, [](ConnProfileMetrics& conn) {
+        conn_metrics_apply(conn, conn.applied, static_cast<uint64_t>(esp_timer_get_time()));
+        conn.sinceUs = 0;
+        conn.requested = ConnProfile::kCentral;
+      });
+      gBleConnHandle.store(BLE_HS_CONN_HANDLE_NONE, std::memory_order_release);
       metrics_set_connected(false);
+      gAdvDisconnectUs = esp_timer_get_time();
       start_ble_advertising(AdvProfile::kFastReconnect);
       return 0;
+    case BLE_GAP_EVENT_CONN_UPDATE: {
+      ble_gap_conn_desc desc = {};
+      if (event->conn_update.status != 0 || ble_gap_conn_find(event->conn_update.conn_handle, &desc) != 0) {
+        const bool failed = event->conn_update.status != 0;
+        link_metrics_write(gConnMetrics, [failed](ConnProfileMetrics& conn) {
+          conn.failures += failed ? 1 : 0;
+          conn.requested = conn.applied;
+        });
+        ESP_LOGW(kTag, "BLE conn update failed; status=%d", event->conn_update.status);
+        return 0;
+      }
+      const ConnProfile profile = classify_conn_interval(desc.conn_itvl);
+      link_metrics_write(gConnMetrics, [&](ConnProfileMetrics& conn) {
+        conn_metrics_apply(conn, profile, static_cast<uint64_t>(esp_timer_get_time()));
+        conn.interval = desc.conn_itvl;
+        conn.latency = desc.conn_latency;
+        conn.timeout = desc.supervision_timeout;
+      });
+      ESP_LOGI(kTag, "BLE conn params itvl=%.2fms latency=%u timeout=%ums (%s)", desc.conn_itvl * 1.25f,
+               static_cast<unsigned>(desc.conn_latency), static_cast<unsigned>(desc.supervision_timeout) * 10U,
+               get_conn_profile_config(profile).label);
+      return 0;
+    }
+    case BLE_GAP_EVENT_SUBSCRIBE:
+      if (event->subscribe.attr_handle == gBleStatusValHandle) {
+        gBleStatusSubscribed.store(event->subscribe.cur_notify != 0, std::memory_order_release);
+        ESP_LOGI(kTag, "BLE status notifications %s", event->subscribe.cur_notify != 0 ? "on" : "off");
+      }
+      return 0;
+    case BLE_GAP_EVENT_MTU: {
+      const int64_t nowUs = esp_timer_get_time();
+      int64_t sinceConnectUs = 0;
+      gBleLink.write([&](BleLinkMetrics& link) {
+        link.mtu = event->mtu.value;
+        link.mtuUs = nowUs;
+        sinceConnectUs = nowUs - link.connectUs;
+      });
+      ESP_LOGI(kTag, "BLE MTU=%u; handle=%u (%.1f ms after connect)", static_cast<unsigned>(event->mtu.value),
+               static_cast<unsigned>(event->mtu.conn_handle), sinceConnectUs / 1000.0);
+      return 0;
+    }
+#ifdef BLE_GAP_EVENT_DATA_LEN_CHG
+    case BLE_GAP_EVENT_DATA_LEN_CHG: {
+      const int64_t nowUs = esp_timer_get_time();
+      gBleLink.write([&](BleLinkMetrics& link) {
+        link.dleTxOctets = event->data_len_chg.max_tx_octets;
+        link.dleTxTimeUs = event->data_len_chg.max_tx_time;
+        link.dleRxOctets = event->data_len_chg.max_rx_octets;
+        link.dleRxTimeUs = event->data_len_chg.max_rx_time;
+        link.dleUs = nowUs;
+      });
+      ESP_LOGI(kTag, "BLE DLE tx=%u/%uus rx=%u/%uus; handle=%u",
+               static_cast<unsigned>(event->data_len_chg.max_tx_octets),
+               static_cast<unsigned>(event->data_len_chg.max_tx_time),
+               static_cast<unsigned>(event->data_len_chg.max_rx_octets),
+               static_cast<unsigned>(event->data_len_chg.max_rx_time),
+               static_cast<unsigned>(event->data_len_chg.conn_handle));
+      return 0;
+    }
+#endif
     case BLE_GAP_EVENT_ADV_COMPLETE:
       gBleAdvertising = false;
       metrics_set_advertising(false);
-      if (gBleConnHandle != BLE_HS_CONN_HANDLE_NONE) {
+      if (gBleConnHandle.load(std::memory_order_acquire) != BLE_HS_CONN_HANDLE_NONE) {
         return 0;
       }
-      if (gAdvProfile == AdvProfile::kFastReconnect &&
-          event->adv_complete.reason == BLE_HS_ETIMEOUT) {
-        ESP_LOGI(kTag, "BLE fast reconnect window expired; switching to slow advertising");
-        start_ble_advertising(AdvProfile::kSlowIdle);
+      if (gAdvProfile != AdvProfile::kSlowIdle && event->adv_complete.reason == BLE_HS_ETIMEOUT) {
+        const AdvProfile next = static_cast<AdvProfile>(static_cast<uint8_t>(gAdvProfile) + 1);
+        ESP_LOGI(kTag, "BLE %s advertising window expired; switching to %s",
+                 get_adv_profile_config(gAdvProfile).label, get_adv_profile_config(next).label);
+        start_ble_advertising(next);
       } else {
         start_ble_advertising(gAdvProfile);
       }
@@ -1068,7 +4103,7 @@ static int ble_gap_event(struct ble_gap_event* event, void*) {
 }
 
 static void start_ble_advertising(AdvProfile profile) {
-  if (gBleConnHandle != BLE_HS_CONN_HANDLE_NONE) {
+  if (gBleConnHandle.load(std::memory_order_acquire) != BLE_HS_CONN_HANDLE_NONE) {
     ESP_LOGW(kTag, "start_ble_advertising ignored while connected");
     gBleAdvertising = false;
     metrics_set_advertising(false);
@@ -1076,6 +4111,7 @@ static void start_ble_advertising(AdvProfile profile) {
   }
 
   const AdvProfileConfig cfg = get_adv_profile_config(profile);
+  const int32_t windowMs = adv_window_ms(profile);
   ble_hs_adv_fields advFields = {};
   advFields.flags = BLE_HS_ADV_F_DISC_GEN | BLE_HS_ADV_F_BREDR_UNSUP;
   advFields.uuids128 = const_cast<ble_uuid128_t*>(&kServiceUuid);
@@ -1107,7 +4143,7 @@ static void start_ble_advertising(AdvProfile profile) {
   params.itvl_min = cfg.intervalMin;
   params.itvl_max = cfg.intervalMax;
 
-  rc = ble_gap_adv_start(gBleAddrType, nullptr, cfg.durationMs, &params, ble_gap_event, nullptr);
+  rc = ble_gap_adv_start(gBleAddrType, nullptr, windowMs, &params, ble_gap_event, nullptr);
   if (rc != 0) {
     ESP_LOGE(kTag, "ble_gap_adv_start failed: %d", rc);
     gBleAdvertising = false;
@@ -1118,9 +4154,14 @@ static void start_ble_advertising(AdvProfile profile) {
   gAdvProfile = profile;
   gBleAdvertising = true;
   metrics_set_advertising(true);
-  ESP_LOGI(kTag, "BLE advertising (%s) as %s (interval %.2f-%.2f s, duration=%s)",
-           cfg.label, kBleDeviceName, cfg.intervalMin * 0.000625f, cfg.intervalMax * 0.000625f,
-           cfg.durationMs == BLE_HS_FOREVER ? "forever" : "15s");
+  if (windowMs == BLE_HS_FOREVER) {
+    ESP_LOGI(kTag, "BLE advertising (%s) as %s (interval %.2f-%.2f s, duration=forever)",
+             cfg.label, kBleDeviceName, cfg.intervalMin * 0.000625f, cfg.intervalMax * 0.000625f);
+  } else {
+    ESP_LOGI(kTag, "BLE advertising (%s) as %s (interval %.2f-%.2f s, duration=%lds)",
+             cfg.label, kBleDeviceName, cfg.intervalMin * 0.000625f, cfg.intervalMax * 0.000625f,
+             static_cast<long>(windowMs / 1000));
+  }
 }
 
 static void ble_host_task(void*) {
@@ -1129,17 +4170,7 @@ static void ble_host_task(void*) {
 }
 
 static bool init_ble() {
-  esp_err_t err = nvs_flash_init();
-  if (err == ESP_ERR_NVS_NO_FREE_PAGES || err == ESP_ERR_NVS_NEW_VERSION_FOUND) {
-    ESP_ERROR_CHECK(nvs_flash_erase());
-    err = nvs_flash_init();
-  }
-  if (err != ESP_OK) {
-    ESP_LOGE(kTag, "nvs_flash_init failed: 0x%x", err);
-    return false;
-  }
-
-  err = nimble_port_init();
+  esp_err_t err = nimble_port_init();
   if (err != ESP_OK) {
     ESP_LOGE(kTag, "nimble_port_init failed: 0x%x", err);
     return false;
@@ -1150,6 +4181,19 @@ static bool init_ble() {
   ble_svc_gap_init();
   ble_svc_gatt_init();
 
+  esp_timer_create_args_t idleTimerArgs = {};
+  idleTimerArgs.callback = ble_conn_idle_timer_cb;
+  idleTimerArgs.name = "ble_conn_idle";
+  err = esp_timer_create(&idleTimerArgs, &gConnIdleTimer);
+  if (err != ESP_OK) {
+    ESP_LOGW(kTag, "conn idle timer create failed: 0x%x", err);
+  }
+
+  const int mtuRc = ble_att_set_preferred_mtu(kBlePreferredMtu);
+  if (mtuRc != 0) {
+    ESP_LOGW(kTag, "ble_att_set_preferred_mtu(%u) rc=%d", static_cast<unsigned>(kBlePreferredMtu), mtuRc);
+  }
+
   int rc = 0;
   rc = ble_svc_gap_device_name_set(kBleDeviceName);
   if (rc != 0) {
@@ -1225,35 +4269,105 @@ static void serial_input_task(void*) {
   }
 }
 
+#if PAGER_COUNT_CXX_ALLOCS
+// Counting wrappers around the global allocator so txbench/ble can show
+// whether anything on the send path still hits the heap. Only operator new is
+// counted; use heap tracing (CONFIG_HEAP_TRACING) to see malloc callers too.
+static void* counted_alloc(size_t size, size_t alignment) noexcept {
+  gCxxHeapAllocs.fetch_add(1, std::memory_order_relaxed);
+  if (gBleIngestTask != nullptr && xTaskGetCurrentTaskHandle() == gBleIngestTask) {
+    gBleIngestAllocs.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (size == 0) {
+    size = 1;
+  }
+  return alignment <= alignof(std::max_align_t) ? std::malloc(size)
+                                                : heap_caps_aligned_alloc(alignment, size, MALLOC_CAP_DEFAULT);
+}
+
+static void* counted_alloc_or_fail(size_t size, size_t alignment) {
+  void* ptr = counted_alloc(size, alignment);
+  if (ptr == nullptr) {
+#if __cpp_exceptions
+    throw std::bad_alloc();
+#else
+    abort();
+#endif
+  }
+  return ptr;
+}
+
+void* operator new(size_t size) { return counted_alloc_or_fail(size, 0); }
+void* operator new[](size_t size) { return counted_alloc_or_fail(size, 0); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return counted_alloc(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return counted_alloc(size, 0); }
+void* operator new(size_t size, std::align_val_t align) {
+  return counted_alloc_or_fail(size, static_cast<size_t>(align));
+}
+void* operator new[](size_t size, std::align_val_t align) {
+  return counted_alloc_or_fail(size, static_cast<size_t>(align));
+}
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+  return counted_alloc(size, static_cast<size_t>(align));
+}
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+  return counted_alloc(size, static_cast<size_t>(align));
+}
+
+// heap_caps_aligned_alloc blocks are released with free() like the rest.
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { std::free(ptr); }
+#endif  // PAGER_COUNT_CXX_ALLOCS
+
 extern "C" void app_main(void) {
   ESP_LOGI(kTag, "Starting ESP-IDF pager bridge");
-  set_idle_line(gConfig.dataGpio, gConfig.output, gConfig.idleHigh);
+  const bool nvsReady = init_nvs();
+  gConfigWriteLock = xSemaphoreCreateMutex();
+  gProfileLock = xSemaphoreCreateMutex();
+  if (nvsReady) {
+    load_config();
+    load_profiles();
+  }
+  const Config cfg = config_snapshot();
+  set_idle_line(cfg.dataGpio, cfg.output, cfg.idleHigh);
   init_user_led();
   const uint64_t now = static_cast<uint64_t>(esp_timer_get_time());
-  portENTER_CRITICAL(&gMetricsMux);
-  gMetrics = {};
-  gCpuMetrics = {};
-  gMetrics.bootUs = now;
-  gMetrics.connStateSinceUs = now;
-  gMetrics.advStateSinceUs = now;
-  gMetrics.connected = false;
-  gMetrics.advertising = false;
-  portEXIT_CRITICAL(&gMetricsMux);
+  gLinkMetricsLock = xSemaphoreCreateMutex();
+  gTxBenchLock = xSemaphoreCreateMutex();
+  gTxCpuLock.create(ESP_PM_CPU_FREQ_MAX, "tx_encode");
+  gTxApbLock.create(ESP_PM_APB_FREQ_MAX, "tx_air");
+  gTxBusyLock.create(ESP_PM_NO_LIGHT_SLEEP, "tx_busy");
+  link_metrics_write(gMetrics, [now](RuntimeMetrics& m) {
+    m = {};
+    m.bootUs = now;
+    m.connStateSinceUs = now;
+    m.advStateSinceUs = now;
+  });
   cpu_metrics_sample();
 
-  gTxQueue = xQueueCreate(2, sizeof(TxJob*));
-  if (gTxQueue == nullptr) {
-    ESP_LOGE(kTag, "Failed to create tx queue");
-    return;
-  }
+  tx_events_subscribe(log_tx_event, nullptr);
+  tx_events_subscribe(ble_notify_tx_event, nullptr);
+  tx_events_subscribe(count_tx_event, nullptr);
 
-  xTaskCreatePinnedToCore(tx_worker_task, "tx_worker", 8192, nullptr, 5, nullptr, 0);
+  xTaskCreatePinnedToCore(tx_worker_task, "tx_worker", 8192, nullptr, 5, &gTxWorkerTask, 0);
+  gWaveTx.set_done_notify(gTxWorkerTask, kTxNotifyDone);
+  xTaskCreatePinnedToCore(ble_ingest_task, "ble_ingest", 6144, nullptr, 4, &gBleIngestTask, 0);
   xTaskCreatePinnedToCore(serial_input_task, "serial_input", 6144, nullptr, 4, nullptr, 0);
   xTaskCreatePinnedToCore(pm_arm_task, "pm_arm", 3072, nullptr, 2, nullptr, 0);
   xTaskCreatePinnedToCore(metrics_task, "metrics", 3072, nullptr, 1, nullptr, 0);
   xTaskCreatePinnedToCore(user_led_task, "user_led", 2048, nullptr, 1, nullptr, 0);
 
-  if (!init_ble()) {
+  if (!nvsReady || !init_ble()) {
     ESP_LOGE(kTag, "BLE init failed; pager bridge unavailable");
   } else {
     ESP_LOGI(kTag, "BLE ready: write 'SEND <message>' to RX characteristic");
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// MSB-first bit stream packed into 32-bit words. Stream bit 0 is bit 31 of
+// words()[0], so a POCSAG codeword appended at a 32-bit boundary is stored as-is.
+class PackedBits {
+ public:
+  void reserve_bits(size_t bits) { words_.reserve((bits + 31) / 32); }
+
+  void clear() {
+    words_.clear();
+    size_ = 0;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const std::vector<uint32_t>& words() const { return words_; }
+  size_t heap_bytes() const { return words_.capacity() * sizeof(uint32_t); }
+
+  bool bit(size_t index) const { return ((words_[index >> 5] >> (31 - (index & 31))) & 0x1) != 0; }
+
+  // Number of consecutive bits equal to bit(index), starting at index.
+  size_t run_length(size_t index) const {
+    const uint32_t flip = bit(index) ? 0xFFFFFFFFu : 0u;
+    size_t pos = index;
+    while (pos < size_) {
+      const unsigned offset = static_cast<unsigned>(pos & 31);
+      // Differing bits show up as ones; the zeros shifted in count as "same".
+      const uint32_t diff = (words_[pos >> 5] ^ flip) << offset;
+      if (diff != 0) {
+        pos += static_cast<unsigned>(__builtin_clz(diff));
+        break;
+      }
+      pos += 32 - offset;
+    }
+    return (pos < size_ ? pos : size_) - index;
+  }
+
+  // Appends the low `count` bits of `value` (1..32), most significant first.
+  void append(uint32_t value, unsigned count) {
+    if (count == 0 || count > 32) {
+      return;
+    }
+    const uint32_t aligned = value << (32 - count);
+    const unsigned offset = static_cast<unsigned>(size_ & 31);
+    if (offset == 0) {
+      words_.push_back(aligned);
+    } else {
+      words_.back() |= aligned >> offset;
+      if (count > 32 - offset) {
+        words_.push_back(aligned << (32 - offset));
+      }
+    }
+    size_ += count;
+  }
+
+  void append_word(uint32_t word) { append(word, 32); }
+
+ private:
+  std::vector<uint32_t> words_;
+  size_t size_ = 0;
+};
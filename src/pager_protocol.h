@@ -0,0 +1,232 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Binary page protocol accepted on the BLE RX characteristic next to the text
+// commands. A write starting with kBinMagic is one binary frame; anything else
+// is parsed as text. Multi-byte fields are little-endian.
+//
+//   frame  := magic(0xB1) version(1) record*
+//   record := opcode(1) msg_id(2) capcode(4) function(1) priority(1) len(1) payload(len)
+//
+// opcode 0x01 pages capcode with payload as the text. capcode is 21 bits;
+// capcode 0 and function 0xFF select the configured defaults; priority is 0
+// urgent, 1 normal, 2 low. Records with an unknown opcode are skipped.
+//
+// opcode 0x02 pages a named recipient profile (`profile add`) instead:
+//
+//   payload := id_len(1) id(id_len) text
+//
+// The profile supplies capcode and baud (the capcode field is ignored);
+// function 0xFF uses the profile's function bits, 0-3 override them.
+//
+// Delivery reports go the other way as notifications on the status
+// characteristic, one entry per page with a non-zero msg_id:
+//
+//   status := magic(0xB2) version(1) count(1) entry*
+//   entry  := stage(1) msg_id(2) queue_depth(1) time_ms(4)
+//
+// time_ms is milliseconds since boot; queue_depth counts pages still waiting.
+//
+// The metrics characteristic (and `metrics bin` on the console) returns one
+// metrics record:
+//
+//   metrics := magic(0xB3) version(1) uptime_s(4) flags(1) queue_depth(1)
+//              queue_high_water(1) cpu_mhz(2) connected_s(4) advertising_s(4)
+//              connects(4) disconnects(4) queued(4) sent(4) failed(4)
+//              dropped(4) coalesced(4) encode_us_last(4) encode_us_max(4)
+//              airtime_ms(4) task_count(1) task*
+//   task    := name(8, NUL padded) cpu_permille(2)
+//
+// flags bit 0 is connected, bit 1 advertising. Counters are totals since boot;
+// cpu_permille is each task's share of run time since boot.
+namespace pager_proto {
+
+constexpr uint8_t kBinMagic = 0xB1;
+constexpr uint8_t kVersion = 1;
+constexpr size_t kFrameHeaderBytes = 2;
+constexpr size_t kRecordHeaderBytes = 10;
+constexpr uint32_t kDefaultCapcode = 0;
+constexpr uint8_t kDefaultFunction = 0xFF;
+constexpr uint8_t kMaxPriority = 2;
+
+enum class Opcode : uint8_t { kPage = 0x01, kProfilePage = 0x02 };
+
+struct Record {
+  Opcode opcode;
+  uint16_t msgId;
+  uint32_t capcode;
+  uint8_t functionBits;
+  uint8_t priority;
+  std::string_view payload;
+};
+
+enum class ReadStatus : uint8_t { kRecord = 0, kEnd = 1, kTruncated = 2 };
+
+constexpr uint8_t kStatusMagic = 0xB2;
+constexpr size_t kStatusHeaderBytes = 3;
+constexpr size_t kStatusEntryBytes = 8;
+
+enum class Stage : uint8_t {
+  kQueued = 1,
+  kOnAir = 2,
+  kTxDone = 3,
+  kTxFail = 4,
+  kDropped = 5,    // queue full, evicted or no free job
+  kCoalesced = 6,  // duplicate of a page already queued or sent
+};
+
+inline void write_status_header(uint8_t* out, uint8_t count) {
+  out[0] = kStatusMagic;
+  out[1] = kVersion;
+  out[2] = count;
+}
+
+inline void write_status_entry(uint8_t* out, Stage stage, uint16_t msgId, uint8_t queueDepth, uint32_t timeMs) {
+  out[0] = static_cast<uint8_t>(stage);
+  out[1] = static_cast<uint8_t>(msgId & 0xFF);
+  out[2] = static_cast<uint8_t>(msgId >> 8);
+  out[3] = queueDepth;
+  out[4] = static_cast<uint8_t>(timeMs & 0xFF);
+  out[5] = static_cast<uint8_t>((timeMs >> 8) & 0xFF);
+  out[6] = static_cast<uint8_t>((timeMs >> 16) & 0xFF);
+  out[7] = static_cast<uint8_t>(timeMs >> 24);
+}
+
+constexpr uint8_t kMetricsMagic = 0xB3;
+constexpr size_t kMetricsFixedBytes = 60;
+constexpr size_t kMetricsTaskBytes = 10;
+constexpr size_t kMetricsTaskNameBytes = 8;
+constexpr size_t kMetricsMaxTasks = 8;
+constexpr size_t kMetricsMaxBytes = kMetricsFixedBytes + kMetricsMaxTasks * kMetricsTaskBytes;
+constexpr uint8_t kMetricsFlagConnected = 0x01;
+constexpr uint8_t kMetricsFlagAdvertising = 0x02;
+
+struct MetricsTask {
+  char name[kMetricsTaskNameBytes];
+  uint16_t cpuPermille;
+};
+
+struct MetricsRecord {
+  uint32_t uptimeS;
+  uint8_t flags;
+  uint8_t queueDepth;
+  uint8_t queueHighWater;
+  uint16_t cpuMhz;
+  uint32_t connectedS;
+  uint32_t advertisingS;
+  uint32_t connects;
+  uint32_t disconnects;
+  uint32_t queued;
+  uint32_t sent;
+  uint32_t failed;
+  uint32_t dropped;
+  uint32_t coalesced;
+  uint32_t encodeUsLast;
+  uint32_t encodeUsMax;
+  uint32_t airtimeMs;
+  uint8_t taskCount;
+  MetricsTask tasks[kMetricsMaxTasks];
+};
+
+inline uint8_t* put_u16(uint8_t* out, uint16_t value) {
+  out[0] = static_cast<uint8_t>(value & 0xFF);
+  out[1] = static_cast<uint8_t>(value >> 8);
+  return out + 2;
+}
+
+inline uint8_t* put_u32(uint8_t* out, uint32_t value) {
+  out[0] = static_cast<uint8_t>(value & 0xFF);
+  out[1] = static_cast<uint8_t>((value >> 8) & 0xFF);
+  out[2] = static_cast<uint8_t>((value >> 16) & 0xFF);
+  out[3] = static_cast<uint8_t>(value >> 24);
+  return out + 4;
+}
+
+// `out` must hold kMetricsMaxBytes; returns the bytes written.
+inline size_t write_metrics_record(const MetricsRecord& record, uint8_t* out) {
+  uint8_t* p = out;
+  *p++ = kMetricsMagic;
+  *p++ = kVersion;
+  p = put_u32(p, record.uptimeS);
+  *p++ = record.flags;
+  *p++ = record.queueDepth;
+  *p++ = record.queueHighWater;
+  p = put_u16(p, record.cpuMhz);
+  for (const uint32_t value : {record.connectedS, record.advertisingS, record.connects, record.disconnects,
+                               record.queued, record.sent, record.failed, record.dropped, record.coalesced,
+                               record.encodeUsLast, record.encodeUsMax, record.airtimeMs}) {
+    p = put_u32(p, value);
+  }
+  const uint8_t taskCount = record.taskCount > kMetricsMaxTasks ? kMetricsMaxTasks : record.taskCount;
+  *p++ = taskCount;
+  for (uint8_t i = 0; i < taskCount; ++i) {
+    for (size_t c = 0; c < kMetricsTaskNameBytes; ++c) {
+      *p++ = static_cast<uint8_t>(record.tasks[i].name[c]);
+    }
+    p = put_u16(p, record.tasks[i].cpuPermille);
+  }
+  return static_cast<size_t>(p - out);
+}
+
+// Splits a kProfilePage payload; false if the id runs past the payload.
+inline bool split_profile_payload(std::string_view payload, std::string_view* id, std::string_view* text) {
+  if (payload.empty() || static_cast<uint8_t>(payload[0]) > payload.size() - 1) {
+    return false;
+  }
+  const size_t idLength = static_cast<uint8_t>(payload[0]);
+  *id = payload.substr(1, idLength);
+  *text = payload.substr(1 + idLength);
+  return true;
+}
+
+constexpr bool is_binary_frame(const char* data, size_t length) {
+  return length >= 1 && static_cast<uint8_t>(data[0]) == kBinMagic;
+}
+
+// Walks the records of one frame without copying; payload views point into
+// the frame buffer.
+class FrameReader {
+ public:
+  FrameReader(const char* data, size_t length) : data_(reinterpret_cast<const uint8_t*>(data)), length_(length) {}
+
+  bool valid_header() const {
+    return length_ >= kFrameHeaderBytes && data_[0] == kBinMagic && data_[1] == kVersion;
+  }
+  uint8_t version() const { return length_ >= kFrameHeaderBytes ? data_[1] : 0; }
+
+  ReadStatus next(Record* out) {
+    if (offset_ < kFrameHeaderBytes) {
+      offset_ = kFrameHeaderBytes;
+    }
+    if (offset_ >= length_) {
+      return ReadStatus::kEnd;
+    }
+    if (length_ - offset_ < kRecordHeaderBytes) {
+      return ReadStatus::kTruncated;
+    }
+    const uint8_t* p = data_ + offset_;
+    const size_t payloadLength = p[9];
+    if (length_ - offset_ - kRecordHeaderBytes < payloadLength) {
+      return ReadStatus::kTruncated;
+    }
+    out->opcode = static_cast<Opcode>(p[0]);
+    out->msgId = static_cast<uint16_t>(p[1] | (p[2] << 8));
+    out->capcode = static_cast<uint32_t>(p[3]) | (static_cast<uint32_t>(p[4]) << 8) |
+                   (static_cast<uint32_t>(p[5]) << 16) | (static_cast<uint32_t>(p[6]) << 24);
+    out->functionBits = p[7];
+    out->priority = p[8];
+    out->payload = std::string_view(reinterpret_cast<const char*>(p + kRecordHeaderBytes), payloadLength);
+    offset_ += kRecordHeaderBytes + payloadLength;
+    return ReadStatus::kRecord;
+  }
+
+ private:
+  const uint8_t* data_;
+  size_t length_;
+  size_t offset_ = 0;
+};
+
+}  // namespace pager_proto
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// BCH(31,21) check-word generation for POCSAG codewords.
+//
+// The check bits are linear over GF(2), so the 21-bit message can be split into
+// three 7-bit slices whose contributions are precomputed and XORed together.
+// Each table entry already holds the 10 remainder bits plus the slice's share of
+// the even-parity bit, i.e. the low 11 bits of the finished codeword.
+namespace pocsag {
+
+constexpr uint32_t kBchPoly = 0x769;  // x^10 + x^9 + x^8 + x^6 + x^5 + x^3 + 1
+constexpr int kBchSliceBits = 7;
+constexpr uint32_t kBchSliceMask = (1u << kBchSliceBits) - 1;
+
+constexpr uint32_t parity32(uint32_t v) {
+  v ^= v >> 16;
+  v ^= v >> 8;
+  v ^= v >> 4;
+  v ^= v >> 2;
+  v ^= v >> 1;
+  return v & 0x1;
+}
+
+// Reference bit-serial encoder; kept for table generation and host verification.
+constexpr uint32_t bch_encode_serial(uint32_t msg21) {
+  uint32_t reg = msg21 << 10;
+  for (int i = 30; i >= 10; --i) {
+    if (reg & (1u << i)) {
+      reg ^= (kBchPoly << (i - 10));
+    }
+  }
+  const uint32_t remainder = reg & 0x3FF;
+  const uint32_t word = (msg21 << 11) | (remainder << 1);
+  return word | parity32(word);
+}
+
+using BchSliceTable = std::array<uint16_t, 1u << kBchSliceBits>;
+
+constexpr BchSliceTable make_bch_slice_table(int shift) {
+  BchSliceTable table = {};
+  for (uint32_t v = 0; v < table.size(); ++v) {
+    table[v] = static_cast<uint16_t>(bch_encode_serial(v << shift) & 0x7FF);
+  }
+  return table;
+}
+
+constexpr BchSliceTable kBchSliceLo = make_bch_slice_table(0);
+constexpr BchSliceTable kBchSliceMid = make_bch_slice_table(kBchSliceBits);
+constexpr BchSliceTable kBchSliceHi = make_bch_slice_table(2 * kBchSliceBits);
+
+constexpr uint32_t bch_encode(uint32_t msg21) {
+  msg21 &= 0x1FFFFF;
+  const uint32_t check = kBchSliceLo[msg21 & kBchSliceMask] ^
+                         kBchSliceMid[(msg21 >> kBchSliceBits) & kBchSliceMask] ^
+                         kBchSliceHi[(msg21 >> (2 * kBchSliceBits)) & kBchSliceMask];
+  return (msg21 << 11) | check;
+}
+
+static_assert(bch_encode(0) == 0, "BCH table encoder broken");
+static_assert(bch_encode(0x1FFFFF) == bch_encode_serial(0x1FFFFF), "BCH table encoder broken");
+static_assert(bch_encode(1u << 20) == bch_encode_serial(1u << 20), "BCH table encoder broken");
+static_assert(bch_encode(0x15A5A5) == bch_encode_serial(0x15A5A5), "BCH table encoder broken");
+
+}  // namespace pocsag
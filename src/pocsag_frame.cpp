@@ -0,0 +1,113 @@
+#include "pocsag_frame.h"
+
+#include "pocsag_bch.h"
+
+namespace pocsag {
+namespace {
+
+constexpr std::array<uint8_t, 128> make_reversed7_table() {
+  std::array<uint8_t, 128> table = {};
+  for (uint32_t v = 0; v < table.size(); ++v) {
+    uint8_t r = 0;
+    for (int b = 0; b < 7; ++b) {
+      r = static_cast<uint8_t>((r << 1) | ((v >> b) & 0x1));
+    }
+    table[v] = r;
+  }
+  return table;
+}
+
+constexpr std::array<uint8_t, 128> kReversed7 = make_reversed7_table();
+
+}  // namespace
+
+// Characters go on air LSB first, so each 7-bit char is bit-reversed and
+// shifted into an accumulator that is drained 20 bits per message word.
+size_t PocsagEncoder::encode_alpha_words(const char* text, size_t length, uint32_t* out, size_t capacity) const {
+  size_t count = 0;
+  uint32_t acc = 0;
+  unsigned accBits = 0;
+  for (size_t i = 0; i < length && count < capacity; ++i) {
+    acc = (acc << 7) | kReversed7[static_cast<uint8_t>(text[i]) & 0x7F];
+    accBits += 7;
+    if (accBits >= 20) {
+      accBits -= 20;
+      out[count++] = bch_encode((1u << 20) | ((acc >> accBits) & 0xFFFFF));
+      acc &= (1u << accBits) - 1;
+    }
+  }
+  if (accBits > 0 && count < capacity) {
+    out[count++] = bch_encode((1u << 20) | ((acc << (20 - accBits)) & 0xFFFFF));
+  }
+  if (length == 0 && capacity > 0) {
+    out[count++] = bch_encode(1u << 20);
+  }
+  return count;
+}
+
+uint32_t PocsagEncoder::build_address_word(uint32_t capcode, uint8_t functionBits) const {
+  const uint32_t address = capcode >> 3;
+  const uint32_t data = ((address & 0x3FFFF) << 2) | (functionBits & 0x3);
+  return bch_encode(data & 0x1FFFFF);
+}
+
+void PocsagBatchPacker::reset(size_t maxBatches) {
+  used_ = 0;
+  pages_ = 0;
+  truncated_ = false;
+  const size_t batches = maxBatches == 0 ? 1 : (maxBatches > kMaxBatchesLimit ? kMaxBatchesLimit : maxBatches);
+  maxSlots_ = batches * kBatchCodewords;
+}
+
+size_t PocsagBatchPacker::gap_for_slot(size_t frameSlot) const {
+  const size_t firstWord = frameSlot * 2;
+  const size_t inBatch = used_ % kBatchCodewords;
+  if (inBatch <= firstWord + 1) {
+    return inBatch <= firstWord ? firstWord - inBatch : 0;
+  }
+  return kBatchCodewords - inBatch + firstWord;
+}
+
+bool PocsagBatchPacker::add(uint32_t capcode, uint8_t functionBits, const char* text, size_t length) {
+  const size_t messageWords = PocsagEncoder::alpha_word_count(length);
+  const size_t addressSlot = used_ + gap_for(capcode);
+  if (addressSlot + 1 + messageWords + 1 > maxSlots_) {
+    if (pages_ > 0) {
+      return false;
+    }
+    truncated_ = true;
+  }
+
+  while (used_ < addressSlot) {
+    slots_[used_++] = kIdleWord;
+  }
+  slots_[used_++] = encoder_.build_address_word(capcode, functionBits);
+  used_ += encoder_.encode_alpha_words(text, length, &slots_[used_], maxSlots_ - used_);
+  ++pages_;
+  return true;
+}
+
+size_t PocsagBatchPacker::finish(PackedBits& out, uint32_t invertMask) const {
+  const size_t used = used_ < maxSlots_ ? used_ + 1 : maxSlots_;
+  const size_t batches = (used + kBatchCodewords - 1) / kBatchCodewords;
+  size_t slot = 0;
+  for (size_t batch = 0; batch < batches; ++batch) {
+    out.append_word(kSyncWord ^ invertMask);
+    for (size_t i = 0; i < kBatchCodewords; ++i, ++slot) {
+      const uint32_t word = slot < used_ ? slots_[slot] : kIdleWord;
+      out.append_word(word ^ invertMask);
+    }
+  }
+  return batches;
+}
+
+void append_preamble(PackedBits& bits, uint32_t preambleBits) {
+  // Every 32-bit chunk starts on an even bit, so each one begins with a one.
+  for (uint32_t remaining = preambleBits; remaining > 0;) {
+    const unsigned chunk = remaining > 32 ? 32U : static_cast<unsigned>(remaining);
+    bits.append(kPreamblePattern >> (32 - chunk), chunk);
+    remaining -= chunk;
+  }
+}
+
+}  // namespace pocsag
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "packed_bits.h"
+
+// Hardware-independent POCSAG frame building: codeword encoding, batch packing
+// and preamble generation. Built into the firmware and into the host tools.
+namespace pocsag {
+
+constexpr uint32_t kSyncWord = 0x7CD215D8;
+constexpr uint32_t kIdleWord = 0x7A89C197;
+constexpr uint32_t kPreamblePattern = 0xAAAAAAAA;
+constexpr size_t kBatchCodewords = 16;
+constexpr size_t kFramesPerBatch = kBatchCodewords / 2;
+constexpr size_t kBatchBits = (kBatchCodewords + 1) * 32;  // sync + 8 frames of 2 codewords
+constexpr size_t kMaxBatchesLimit = 16;                    // hard cap behind Config::maxBatches
+
+// The frame an address must be sent in: the low three capcode bits.
+constexpr size_t frame_slot(uint32_t capcode) { return capcode & (kFramesPerBatch - 1); }
+
+class PocsagEncoder {
+ public:
+  static size_t alpha_word_count(size_t length) { return length == 0 ? 1 : (length * 7 + 19) / 20; }
+
+  // Writes at most `capacity` message codewords for `text` to `out` and
+  // returns how many it wrote.
+  size_t encode_alpha_words(const char* text, size_t length, uint32_t* out, size_t capacity) const;
+
+  uint32_t build_address_word(uint32_t capcode, uint8_t functionBits) const;
+};
+
+// Packs pages for one or more capcodes into shared batches behind a single
+// preamble. Each address word lands in its capcode's frame (capcode & 7),
+// skipped slots are idle, and the next address (or trailing idle) ends a message.
+class PocsagBatchPacker {
+ public:
+  void reset(size_t maxBatches);
+
+  size_t pages() const { return pages_; }
+  bool truncated() const { return truncated_; }
+
+  // Idle codewords that would precede an address in this frame slot (or for
+  // this capcode) if added now.
+  size_t gap_for_slot(size_t frameSlot) const;
+  size_t gap_for(uint32_t capcode) const { return gap_for_slot(frame_slot(capcode)); }
+
+  // Returns false (and leaves the packer unchanged) when the page does not fit
+  // in the remaining batches. The first page always fits, truncated if needed.
+  bool add(uint32_t capcode, uint8_t functionBits, const char* text, size_t length);
+
+  // Pads with idle codewords to a batch boundary (keeping at least one idle
+  // terminator when room allows) and appends sync-prefixed batches.
+  size_t finish(PackedBits& out, uint32_t invertMask) const;
+
+ private:
+  PocsagEncoder encoder_;
+  std::array<uint32_t, kMaxBatchesLimit * kBatchCodewords> slots_ = {};
+  size_t used_ = 0;
+  size_t maxSlots_ = kBatchCodewords;
+  size_t pages_ = 0;
+  bool truncated_ = false;
+};
+
+// Preamble is 1010... starting with a one.
+void append_preamble(PackedBits& bits, uint32_t preambleBits);
+
+}  // namespace pocsag
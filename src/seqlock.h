@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Sequence lock for small plain structs: one writer at a time updates the
+// value in place, readers copy it and retry if a write overlapped. Readers
+// never block the writer and nobody masks interrupts, so it suits metrics
+// that are written by one task and read from logging or BLE callbacks.
+// Writers must be serialised by the caller (one owning task, or a mutex).
+template <typename T>
+class Seqlock {
+  static_assert(std::is_trivially_copyable<T>::value, "Seqlock holds trivially copyable values");
+
+ public:
+  // Runs fn(T&) on the live value. Task context only; fn must not block.
+  // The scheduler is suspended for the update, so a higher-priority reader on
+  // this core cannot preempt a half-finished write and spin on it forever.
+  template <typename Fn>
+  void write(Fn&& fn) {
+    vTaskSuspendAll();
+    const uint32_t seq = seq_.load(std::memory_order_relaxed);
+    seq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    fn(value_);
+    seq_.store(seq + 2, std::memory_order_release);
+    xTaskResumeAll();
+  }
+
+  // Any task. A retry only waits for a write running on the other core.
+  T read() const {
+    T copy;
+    uint32_t before = 0;
+    do {
+      before = seq_.load(std::memory_order_acquire);
+      copy = value_;
+      std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((before & 1U) != 0 || seq_.load(std::memory_order_relaxed) != before);
+    return copy;
+  }
+
+ private:
+  std::atomic<uint32_t> seq_{0};
+  T value_{};
+};
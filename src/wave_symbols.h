@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "packed_bits.h"
+
+// Boundary between the portable bit stream and the transmitter hardware.
+// A sink (the RMT streaming encoder on target, a mock on the host) pulls
+// 32-bit symbol words from BitRunSymbolSource as its memory drains. The word
+// layout matches rmt_symbol_word_t::val: duration0[14:0] level0[15]
+// duration1[30:16] level1[31], durations in bit-clock ticks (1 us).
+namespace pocsag {
+
+constexpr uint32_t kMaxRmtDuration = 32767;
+
+struct WaveStreamInput {
+  const PackedBits* bits;
+  uint32_t bitPeriodUs;
+  bool driveOneLow;
+};
+
+constexpr uint32_t make_symbol_word(uint32_t duration0, bool level0, uint32_t duration1, bool level1) {
+  return (duration0 & 0x7FFF) | (level0 ? 1u << 15 : 0u) | ((duration1 & 0x7FFF) << 16) |
+         (level1 ? 1u << 31 : 0u);
+}
+
+constexpr uint32_t symbol_duration(uint32_t word) { return (word & 0x7FFF) + ((word >> 16) & 0x7FFF); }
+
+// Expands a packed bit stream into symbol words one at a time: each run of
+// equal bits becomes one level, split into kMaxRmtDuration chunks. Called
+// from the RMT ISR on target; it must not log or allocate.
+class BitRunSymbolSource {
+ public:
+  void reset(const WaveStreamInput& input) {
+    input_ = input;
+    index_ = 0;
+    remainingUs_ = 0;
+    levelHigh_ = false;
+  }
+
+  bool next(uint32_t* out) {
+    if (remainingUs_ == 0) {
+      if (input_.bits == nullptr || index_ >= input_.bits->size()) {
+        return false;
+      }
+      const bool value = input_.bits->bit(index_);
+      const size_t runLength = input_.bits->run_length(index_);
+      index_ += runLength;
+      remainingUs_ = static_cast<uint32_t>(runLength) * input_.bitPeriodUs;
+      levelHigh_ = input_.driveOneLow ? !value : value;
+    }
+
+    const uint32_t chunk = remainingUs_ > kMaxRmtDuration ? kMaxRmtDuration : remainingUs_;
+    *out = make_symbol_word(chunk > 1 ? chunk - 1 : 1, levelHigh_, 1, levelHigh_);
+    remainingUs_ -= chunk;
+    return true;
+  }
+
+ private:
+  WaveStreamInput input_ = {};
+  size_t index_ = 0;
+  uint32_t remainingUs_ = 0;
+  bool levelHigh_ = false;
+};
+
+}  // namespace pocsag